@@ -26,7 +26,10 @@
 #include "Application.hh"
 #include "Display.hh"
 #include "EventHandler.hh"
+#include "Image.hh"
 #include "Menu.hh"
+#include "Pen.hh"
+#include "PixmapCache.hh"
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
@@ -60,6 +63,13 @@ static void *workaround __attribute__((__unused__)) = 0;
 #endif
 
 
+#ifdef    MITSHM
+namespace bt {
+  bool processShmEvent(const XEvent *event);
+} // namespace bt
+#endif // MITSHM
+
+
 static bt::Application *base_app = 0;
 static sig_atomic_t pending_signals = 0;
 
@@ -239,13 +249,25 @@ void bt::Application::run(void) {
     if (run_state != RUNNING)
       break;
 
+    // no events are pending, render a scheduled pixmap or save a
+    // rendered image
+    bool idle_work = PixmapCache::renderIdle();
+    if (!idle_work)
+      idle_work = Image::writeRenderCache();
+    if (!idle_work)
+      Image::trimRenderBuffers();
+
     fd_set rfds;
     ::timeval now, tm, *timeout = 0;
 
     FD_ZERO(&rfds);
     FD_SET(xfd, &rfds);
 
-    if (!timerList.empty()) {
+    if (idle_work) {
+      // more to render, just poll for events
+      tm.tv_sec = tm.tv_usec = 0;
+      timeout = &tm;
+    } else if (!timerList.empty()) {
       const bt::Timer* const timer = timerList.top();
 
       gettimeofday(&now, 0);
@@ -297,6 +319,12 @@ void bt::Application::run(void) {
 }
 
 void bt::Application::process_event(XEvent *event) {
+#ifdef    MITSHM
+  // MIT-SHM upload completions are sent for pixmaps, not windows
+  if (processShmEvent(event))
+    return;
+#endif // MITSHM
+
   bt::EventHandler *handler = findEventHandler(event->xany.window);
   if (!handler)
     return;
@@ -585,6 +613,8 @@ void bt::Application::insertEventHandler(Window window,
 
 void bt::Application::removeEventHandler(Window window) {
   eventhandlers.erase(window);
+  // the window is about to go away
+  Pen::releaseDrawable(window);
 }
 
 
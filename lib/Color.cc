@@ -26,12 +26,21 @@
 #include "Color.hh"
 #include "Display.hh"
 
-#include <map>
+#include <algorithm>
+#include <vector>
 
 #include <X11/Xlib.h>
+#ifdef    HAVE_X11_XLIBINT_H
+#  include <X11/Xlibint.h>
+// Xlibint.h defines these as macros
+#  undef min
+#  undef max
+#endif // HAVE_X11_XLIBINT_H
 
 #include <assert.h>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 // #define COLORCACHE_DEBUG
 
@@ -60,55 +69,108 @@ namespace bt {
 
     /*
       Clears the color cache.  All colors with a zero reference count
-      are freed.
+      are freed, except those allocated by allocateDeferred() since
+      the last clear.
 
       If force is true, then all colors are freed, regardless of the
       reference count.  This is done when destroying the cache.
     */
     void clear(bool force);
 
+    /*
+      While deferring, colors passed to defer() that would need to be
+      allocated are remembered.  allocateDeferred() allocates them all
+      at once and adds them to the cache with a zero reference count.
+      They survive the next clear(), because a style is loaded before
+      the widgets that use its colors are drawn (see
+      Blackbox::reconfigure()).
+    */
+    inline void startDeferring(void)
+    { deferring = true; }
+    void defer(unsigned int screen, int r, int g, int b);
+    void allocateDeferred(void);
+
   private:
     const Display &_display;
 
-    struct RGB {
-      const unsigned int screen;
-      const int r, g, b;
-
-      inline RGB(void)
-        : screen(~0u), r(-1), g(-1), b(-1)
-      { }
-      inline RGB(const unsigned int s, const int x, const int y, const int z)
-        : screen(s), r(x), g(y), b(z)
-      { }
-      inline RGB(const RGB &x)
-        : screen(x.screen), r(x.r), g(x.g), b(x.b)
+    /*
+      How pixels are obtained on a screen.  Read-only TrueColor and
+      StaticColor colormaps never change, so their pixels are computed
+      locally instead of asking the server for every new color.
+    */
+    struct ScreenVisual {
+      enum Kind { Unknown, Allocated, Computed, Matched };
+      Kind kind;
+      // Computed: pixel = level << shift, level in [0, max]
+      int red_shift, green_shift, blue_shift;
+      unsigned long red_max, green_max, blue_max;
+      // Matched: the contents of the colormap
+      std::vector<XColor> entries;
+
+      inline ScreenVisual(void)
+        : kind(Unknown),
+          red_shift(0), green_shift(0), blue_shift(0),
+          red_max(0ul), green_max(0ul), blue_max(0ul)
       { }
 
-      inline bool operator==(const RGB &x) const
-      { return screen == x.screen && r == x.r && g == x.g && b == x.b; }
-
-      inline bool operator<(const RGB &x) const {
-        const unsigned long p1 =
-          (screen << 24 | r << 16 | g << 8 | b) & 0xffffffff;
-        const unsigned long p2 =
-          (x.screen << 24 | x.r << 16 | x.g << 8 | x.b) & 0xffffffff;
-        return p1 < p2;
-      }
+      unsigned long pixel(int r, int g, int b) const;
     };
-    struct PixelRef {
-      const unsigned long pixel;
+    std::vector<ScreenVisual> visuals;
+
+    const ScreenVisual &screenVisual(unsigned int screen);
+
+    /*
+      The cache is a flat open addressing hash table keyed by the
+      packed screen and rgb, with linear probing.  It is kept at most
+      half full.
+    */
+    enum { EmptyKey = 0xffffffffu };
+
+    struct Entry {
+      unsigned long key;
+      unsigned long pixel;
       unsigned int count;
-      inline PixelRef(void)
-        : pixel(0ul), count(0u)
+
+      inline Entry(void)
+        : key(EmptyKey), pixel(0ul), count(0u)
       { }
-      inline PixelRef(const unsigned long x)
-        : pixel(x), count(1u)
+      inline Entry(unsigned long k, unsigned long p, unsigned int c)
+        : key(k), pixel(p), count(c)
       { }
+
+      inline bool operator<(const Entry &e) const
+      { return key < e.key; }
     };
 
-    typedef std::map<RGB,PixelRef> Cache;
-    typedef Cache::value_type CacheItem;
-    Cache cache;
+    static inline unsigned long packKey(unsigned int screen,
+                                        int r, int g, int b) {
+      assert(screen < 255u);
+      return (screen << 24 | r << 16 | g << 8 | b) & 0xffffffff;
+    }
+    static inline unsigned int keyScreen(unsigned long key)
+    { return (key >> 24) & 0xff; }
+
+    inline size_t home(unsigned long key) const {
+      // Fibonacci hashing: the top bits of the 32 bit product depend
+      // on every bit of the key, the screen included
+      return static_cast<size_t>(((key * 2654435769u) & 0xffffffffu)
+                                 >> shift);
+    }
+
+    Entry *lookup(unsigned long key);
+    Entry &insert(unsigned long key, unsigned long pixel, unsigned int count);
+    void rehash(size_t size);
+
+    std::vector<Entry> slots;
+    size_t used;
+    unsigned int shift; // 32 - log2(slots.size())
+
+    bool deferring;
+    std::vector<unsigned long> deferred;
+    // sorted keys allocated by allocateDeferred() since the last clear()
+    std::vector<unsigned long> batched;
+
+    bool allocate(unsigned int screen, XColor *colors, unsigned int count);
   };
 
 
@@ -126,11 +188,49 @@ namespace bt {
     colorcache = 0;
   }
 
+
+#ifdef    HAVE_X11_XLIBINT_H
+  /*
+    Collects the AllocColor replies for a range of request sequence
+    numbers, the way Xlib itself pipelines GetWindowAttributes and
+    GetGeometry.
+  */
+  struct AllocColorBatch {
+    unsigned long first, last;
+    XColor *colors;
+    std::vector<bool> allocated;
+  };
+
+  static Bool allocColorHandler(::Display *dpy, xReply *rep,
+                                char *, int, XPointer data) {
+    AllocColorBatch * const batch = reinterpret_cast<AllocColorBatch *>(data);
+    const unsigned long sequence = dpy->last_request_read;
+    if (sequence < batch->first || sequence > batch->last)
+      return False;
+
+    const unsigned long i = sequence - batch->first;
+    if (rep->generic.type == X_Error) {
+      // most likely BadAlloc, reported by the caller
+      return True;
+    }
+
+    const xAllocColorReply * const reply =
+      reinterpret_cast<const xAllocColorReply *>(rep);
+    batch->colors[i].pixel = reply->pixel;
+    batch->colors[i].red   = reply->red;
+    batch->colors[i].green = reply->green;
+    batch->colors[i].blue  = reply->blue;
+    batch->allocated[i] = true;
+    return True;
+  }
+#endif // HAVE_X11_XLIBINT_H
+
 } // namespace bt
 
 
 bt::ColorCache::ColorCache(const Display &display)
-  : _display(display)
+  : _display(display), visuals(display.screenCount()),
+    slots(64), used(0), shift(32 - 6), deferring(false)
 { }
 
 
@@ -138,6 +238,196 @@ bt::ColorCache::~ColorCache(void)
 { clear(true); }
 
 
+const bt::ColorCache::ScreenVisual &
+bt::ColorCache::screenVisual(unsigned int screen) {
+  // like Display::screenInfo(), a single screen may have any number
+  ScreenVisual &visual = visuals[visuals.size() == 1 ? 0 : screen];
+  if (visual.kind != ScreenVisual::Unknown)
+    return visual;
+
+  const ScreenInfo &screeninfo = _display.screenInfo(screen);
+  const Visual * const v = screeninfo.visual();
+  switch (v->c_class) {
+  case TrueColor: {
+    visual.kind = ScreenVisual::Computed;
+    visual.red_shift = visual.green_shift = visual.blue_shift = 0;
+    while (!((v->red_mask >> visual.red_shift) & 1))
+      ++visual.red_shift;
+    while (!((v->green_mask >> visual.green_shift) & 1))
+      ++visual.green_shift;
+    while (!((v->blue_mask >> visual.blue_shift) & 1))
+      ++visual.blue_shift;
+    visual.red_max = v->red_mask >> visual.red_shift;
+    visual.green_max = v->green_mask >> visual.green_shift;
+    visual.blue_max = v->blue_mask >> visual.blue_shift;
+    break;
+  }
+
+  case StaticColor: {
+    // one round trip for the whole colormap
+    visual.kind = ScreenVisual::Matched;
+    visual.entries.resize(v->map_entries);
+    for (int i = 0; i < v->map_entries; ++i)
+      visual.entries[i].pixel = i;
+    XQueryColors(_display.XDisplay(), screeninfo.colormap(),
+                 &visual.entries[0], v->map_entries);
+    break;
+  }
+
+  default:
+    visual.kind = ScreenVisual::Allocated;
+    break;
+  }
+
+#ifdef COLORCACHE_DEBUG
+  fprintf(stderr, gettext("bt::ColorCache: screen %u, %s pixels\n"),
+          screen,
+          (visual.kind == ScreenVisual::Computed
+           ? "computed"
+           : (visual.kind == ScreenVisual::Matched
+              ? "matched"
+              : "allocated")));
+#endif // COLORCACHE_DEBUG
+
+  return visual;
+}
+
+
+unsigned long bt::ColorCache::ScreenVisual::pixel(int r, int g, int b) const {
+  if (kind == Computed) {
+    // nearest level, as the server would pick
+    return ((((r * red_max + 127) / 255) << red_shift)
+            | (((g * green_max + 127) / 255) << green_shift)
+            | (((b * blue_max + 127) / 255) << blue_shift));
+  }
+
+  assert(kind == Matched && !entries.empty());
+  unsigned long best = entries[0].pixel;
+  long best_distance = -1;
+  for (unsigned int i = 0; i < entries.size(); ++i) {
+    const long dr = (entries[i].red >> 8) - r;
+    const long dg = (entries[i].green >> 8) - g;
+    const long db = (entries[i].blue >> 8) - b;
+    const long distance = dr * dr + dg * dg + db * db;
+    if (best_distance < 0 || distance < best_distance) {
+      best = entries[i].pixel;
+      best_distance = distance;
+      if (distance == 0)
+        break;
+    }
+  }
+  return best;
+}
+
+
+bt::ColorCache::Entry *bt::ColorCache::lookup(unsigned long key) {
+  const size_t mask = slots.size() - 1;
+  for (size_t i = home(key); slots[i].key != EmptyKey; i = (i + 1) & mask) {
+    if (slots[i].key == key)
+      return &slots[i];
+  }
+  return 0;
+}
+
+
+bt::ColorCache::Entry &bt::ColorCache::insert(unsigned long key,
+                                              unsigned long pixel,
+                                              unsigned int count) {
+  assert(lookup(key) == 0);
+  if ((used + 1) * 2 > slots.size())
+    rehash(slots.size() * 2);
+
+  const size_t mask = slots.size() - 1;
+  size_t i = home(key);
+  while (slots[i].key != EmptyKey)
+    i = (i + 1) & mask;
+  slots[i] = Entry(key, pixel, count);
+  ++used;
+  return slots[i];
+}
+
+
+void bt::ColorCache::rehash(size_t size) {
+  std::vector<Entry> old(size);
+  old.swap(slots);
+  used = 0;
+  shift = 32;
+  while (size > 1) {
+    size >>= 1;
+    --shift;
+  }
+  for (size_t i = 0; i < old.size(); ++i) {
+    if (old[i].key != EmptyKey)
+      insert(old[i].key, old[i].pixel, old[i].count);
+  }
+}
+
+
+/*
+  Allocates count colors on the screen's colormap.  Returns false if
+  any of them could not be allocated; those get the black pixel.
+*/
+bool bt::ColorCache::allocate(unsigned int screen,
+                              XColor *colors, unsigned int count) {
+  ::Display * const dpy = _display.XDisplay();
+  const Colormap colormap = _display.screenInfo(screen).colormap();
+  bool ok = true;
+
+#ifdef    HAVE_X11_XLIBINT_H
+  if (count > 1u) {
+    // send all requests, then wait for the replies once
+    AllocColorBatch batch;
+    batch.colors = colors;
+    batch.allocated.resize(count, false);
+
+    _XAsyncHandler async;
+    xGetInputFocusReply rep;
+    xReq *req;
+    xAllocColorReq *alloc;
+
+    LockDisplay(dpy);
+    async.next = dpy->async_handlers;
+    async.handler = allocColorHandler;
+    async.data = reinterpret_cast<XPointer>(&batch);
+    dpy->async_handlers = &async;
+
+    batch.first = dpy->request + 1;
+    for (unsigned int i = 0; i < count; ++i) {
+      GetReq(AllocColor, alloc);
+      alloc->cmap = colormap;
+      alloc->red = colors[i].red;
+      alloc->green = colors[i].green;
+      alloc->blue = colors[i].blue;
+    }
+    batch.last = dpy->request;
+
+    GetEmptyReq(GetInputFocus, req);
+    (void) req;
+    (void) _XReply(dpy, reinterpret_cast<xReply *>(&rep), 0, xTrue);
+    DeqAsyncHandler(dpy, &async);
+    UnlockDisplay(dpy);
+    SyncHandle();
+
+    for (unsigned int i = 0; i < count; ++i) {
+      if (!batch.allocated[i]) {
+        colors[i].pixel = BlackPixel(dpy, screen);
+        ok = false;
+      }
+    }
+    return ok;
+  }
+#endif // HAVE_X11_XLIBINT_H
+
+  for (unsigned int i = 0; i < count; ++i) {
+    if (!XAllocColor(dpy, colormap, &colors[i])) {
+      colors[i].pixel = BlackPixel(dpy, screen);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+
 unsigned long bt::ColorCache::find(unsigned int screen, int r, int g, int b) {
   if (r < 0 || r > 255)
     r = 0;
@@ -146,19 +436,25 @@ unsigned long bt::ColorCache::find(unsigned int screen, int r, int g, int b) {
   if (b < 0 || b > 255)
     b = 0;
 
+  const ScreenVisual &visual = screenVisual(screen);
+  if (visual.kind != ScreenVisual::Allocated) {
+    // nothing to allocate, reference count or free
+    return visual.pixel(r, g, b);
+  }
+
   // see if we have allocated this color before
-  RGB rgb(screen, r, g, b);
-  Cache::iterator it = cache.find(rgb);
-  if (it != cache.end()) {
+  const unsigned long key = packKey(screen, r, g, b);
+  Entry *entry = lookup(key);
+  if (entry) {
     // found a cached color, use it
-    ++it->second.count;
+    ++entry->count;
 
 #ifdef COLORCACHE_DEBUG
     fprintf(stderr, gettext("bt::ColorCache: use %02x/%02x/%02x, count %4u\n"),
-            r, g, b, it->second.count);
+            r, g, b, entry->count);
 #endif // COLORCACHE_DEBUG
 
-    return it->second.pixel;
+    return entry->pixel;
   }
 
   XColor xcol;
@@ -168,12 +464,10 @@ unsigned long bt::ColorCache::find(unsigned int screen, int r, int g, int b) {
   xcol.pixel = 0;
   xcol.flags = DoRed | DoGreen | DoBlue;
 
-  Colormap colormap = _display.screenInfo(screen).colormap();
-  if (!XAllocColor(_display.XDisplay(), colormap, &xcol)) {
+  if (!allocate(screen, &xcol, 1)) {
     fprintf(stderr,
             gettext("bt::Color::pixel: cannot allocate color 'rgb:%02x/%02x/%02x'\n"),
             r, g, b);
-    xcol.pixel = BlackPixel(_display.XDisplay(), screen);
   }
 
 #ifdef COLORCACHE_DEBUG
@@ -181,13 +475,16 @@ unsigned long bt::ColorCache::find(unsigned int screen, int r, int g, int b) {
           r, g, b, xcol.pixel);
 #endif // COLORCACHE_DEBUG
 
-  cache.insert(CacheItem(rgb, PixelRef(xcol.pixel)));
+  insert(key, xcol.pixel, 1u);
 
   return xcol.pixel;
 }
 
 
 void bt::ColorCache::release(unsigned int screen, int r, int g, int b) {
+  if (screenVisual(screen).kind != ScreenVisual::Allocated)
+    return; // never entered the cache
+
   if (r < 0 || r > 255)
     r = 0;
   if (g < 0 || g > 255)
@@ -195,65 +492,161 @@ void bt::ColorCache::release(unsigned int screen, int r, int g, int b) {
   if (b < 0 || b > 255)
     b = 0;
 
-  RGB rgb(screen, r, g, b);
-  Cache::iterator it = cache.find(rgb);
+  Entry * const entry = lookup(packKey(screen, r, g, b));
 
-  assert(it != cache.end() && it->second.count > 0);
-  --it->second.count;
+  assert(entry != 0 && entry->count > 0);
+  --entry->count;
 
 #ifdef COLORCACHE_DEBUG
   fprintf(stderr, gettext("bt::ColorCache: rel %02x/%02x/%02x, count %4u\n"),
-          r, g, b, it->second.count);
+          r, g, b, entry->count);
 #endif // COLORCACHE_DEBUG
 }
 
 
 void bt::ColorCache::clear(bool force) {
-  Cache::iterator it = cache.begin();
-  if (it == cache.end())
+  if (used == 0)
     return; // nothing to do
 
 #ifdef COLORCACHE_DEBUG
   fprintf(stderr, gettext("bt::ColorCache: clearing cache, %u entries\n"),
-          cache.size());
+          used);
 #endif // COLORCACHE_DEBUG
 
-  unsigned long *pixels = new unsigned long[ cache.size() ];
-  unsigned int screen, count;
+  // one pass: keep the referenced entries, collect the rest
+  std::vector<Entry> old(slots.size());
+  old.swap(slots);
+  used = 0;
+
+  std::vector<Entry> freed;
+  for (size_t i = 0; i < old.size(); ++i) {
+    if (old[i].key == EmptyKey)
+      continue;
+    if (!force
+        && (old[i].count != 0
+            || std::binary_search(batched.begin(), batched.end(),
+                                  old[i].key))) {
+      insert(old[i].key, old[i].pixel, old[i].count);
+      continue;
+    }
 
-  for (screen = 0; screen < _display.screenCount(); ++screen) {
-    count = 0;
-    it = cache.begin();
-    while (it != cache.end()) {
-      if (it->second.count != 0 && !force) {
-        ++it;
-        continue;
-      }
+#ifdef COLORCACHE_DEBUG
+    fprintf(stderr, gettext("bt::ColorCache: fre %02x/%02x/%02x, pixel %08lx\n"),
+            (old[i].key >> 16) & 0xff, (old[i].key >> 8) & 0xff,
+            old[i].key & 0xff, old[i].pixel);
+#endif // COLORCACHE_DEBUG
+
+    freed.push_back(old[i]);
+  }
+
+  // the screen is in the high bits of the key, so sorting groups the
+  // pixels by colormap
+  std::sort(freed.begin(), freed.end());
+  std::vector<unsigned long> pixels;
+  pixels.reserve(freed.size());
+  for (size_t i = 0; i < freed.size(); ) {
+    const unsigned int screen = keyScreen(freed[i].key);
+    pixels.clear();
+    for (; i < freed.size() && keyScreen(freed[i].key) == screen; ++i)
+      pixels.push_back(freed[i].pixel);
+
+    XFreeColors(_display.XDisplay(),
+                _display.screenInfo(screen).colormap(),
+                &pixels[0], pixels.size(), 0);
+  }
+
+  // the next clear() frees whatever of the batch is still unused
+  batched.clear();
 
 #ifdef COLORCACHE_DEBUG
-      fprintf(stderr, gettext("bt::ColorCache: fre %02x/%02x/%02x, pixel %08lx\n"),
-              it->first.r, it->first.g, it->first.b, it->second.pixel);
+  fprintf(stderr, gettext("bt::ColorCache: cleared, %u entries remain\n"),
+          used);
 #endif // COLORCACHE_DEBUG
+}
+
 
-      pixels[count++] = it->second.pixel;
+void bt::ColorCache::defer(unsigned int screen, int r, int g, int b) {
+  if (!deferring || r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255)
+    return;
+  if (screenVisual(screen).kind != ScreenVisual::Allocated)
+    return;
 
-      Cache::iterator r = it++;
-      cache.erase(r);
+  const unsigned long key = packKey(screen, r, g, b);
+  const Entry * const entry = lookup(key);
+  if (!entry)
+    deferred.push_back(key);
+  else if (entry->count == 0)
+    batched.push_back(key); // still cached from an earlier style
+}
+
+
+void bt::ColorCache::allocateDeferred(void) {
+  deferring = false;
+
+  std::sort(deferred.begin(), deferred.end());
+  deferred.erase(std::unique(deferred.begin(), deferred.end()),
+                 deferred.end());
+
+  std::vector<XColor> colors;
+  for (size_t i = 0; i < deferred.size(); ) {
+    const unsigned int screen = keyScreen(deferred[i]);
+    const size_t first = i;
+    colors.clear();
+    for (; i < deferred.size() && keyScreen(deferred[i]) == screen; ++i) {
+      if (lookup(deferred[i]))
+        continue; // allocated since it was deferred
+
+      XColor xcol;
+      const int r = (deferred[i] >> 16) & 0xff;
+      const int g = (deferred[i] >> 8) & 0xff;
+      const int b = deferred[i] & 0xff;
+      xcol.red   = r | r << 8;
+      xcol.green = g | g << 8;
+      xcol.blue  = b | b << 8;
+      xcol.pixel = 0;
+      xcol.flags = DoRed | DoGreen | DoBlue;
+      colors.push_back(xcol);
+    }
+    if (colors.empty())
+      continue;
+
+    if (!allocate(screen, &colors[0], colors.size())) {
+      fprintf(stderr,
+              gettext("bt::Color::pixel: cannot allocate all colors on "
+                      "screen %u\n"),
+              screen);
     }
 
-    if (count > 0u) {
-      XFreeColors(_display.XDisplay(),
-                  _display.screenInfo(screen).colormap(),
-                  pixels, count, 0);
+#ifdef COLORCACHE_DEBUG
+    fprintf(stderr, gettext("bt::ColorCache: allocated %u colors at once\n"),
+            static_cast<unsigned int>(colors.size()));
+#endif // COLORCACHE_DEBUG
+
+    // unreferenced until used, the second clear() frees what is
+    // never used
+    unsigned int c = 0;
+    for (size_t j = first; j < i; ++j) {
+      if (lookup(deferred[j]))
+        continue;
+      insert(deferred[j], colors[c++].pixel, 0u);
+      batched.push_back(deferred[j]);
     }
   }
 
-  delete [] pixels;
+  std::sort(batched.begin(), batched.end());
+  deferred.clear();
+}
 
-#ifdef COLORCACHE_DEBUG
-  fprintf(stderr, gettext("bt::ColorCache: cleared, %u entries remain\n"),
-          cache.size());
-#endif // COLORCACHE_DEBUG
+
+void bt::Color::deferAllocation(void) {
+  if (colorcache)
+    colorcache->startDeferring();
+}
+
+
+void bt::Color::allocateDeferred(void) {
+  if (colorcache)
+    colorcache->allocateDeferred();
 }
 
 
@@ -264,6 +657,116 @@ void bt::Color::clearCache(void)
 }
 
 
+namespace bt {
+
+  // ColorNames.cc
+  bool findColorName(const std::string &name, int &r, int &g, int &b);
+
+  static inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  static bool startsWith(const std::string &str, const char *prefix) {
+    const std::string::size_type len = strlen(prefix);
+    return (str.length() >= len
+            && strncasecmp(str.c_str(), prefix, len) == 0);
+  }
+
+  /*
+    Splits "a/b/c" into its three components.  Extra slashes end up
+    in the last one and make it invalid.
+  */
+  static bool splitComponents(const std::string &str, std::string parts[3]) {
+    std::string::size_type start = 0;
+    for (int i = 0; i < 3; ++i) {
+      const std::string::size_type end =
+        (i < 2) ? str.find('/', start) : str.length();
+      if (end == std::string::npos || end == start)
+        return false;
+      parts[i] = str.substr(start, end - start);
+      start = end + 1;
+    }
+    return true;
+  }
+
+  /*
+    Parses the color specifications that Xlib resolves without the
+    server: #rgb with 1 to 4 hex digits per component, rgb:r/g/b,
+    rgbi:r/g/b and the X11 color names.  The results are the same as
+    XParseColor() on a linear RGB device.  Returns false for anything
+    else, which is left to XParseColor().
+  */
+  static bool parseColor(const std::string &spec, XColor &xcol) {
+    unsigned short rgb[3];
+
+    if (spec[0] == '#') {
+      const std::string::size_type n = spec.length() - 1;
+      if (n == 0 || n % 3 != 0 || n > 12)
+        return false;
+      const unsigned int digits = n / 3;
+      for (unsigned int i = 0; i < 3; ++i) {
+        unsigned int value = 0;
+        for (unsigned int j = 0; j < digits; ++j) {
+          const int d = hexDigit(spec[1 + i * digits + j]);
+          if (d < 0)
+            return false;
+          value = (value << 4) | d;
+        }
+        // #rgb means #r000g000b000, not #rrrrggggbbbb
+        rgb[i] = value << (16 - digits * 4);
+      }
+    } else if (startsWith(spec, "rgb:")) {
+      std::string parts[3];
+      if (!splitComponents(spec.substr(4), parts))
+        return false;
+      for (unsigned int i = 0; i < 3; ++i) {
+        if (parts[i].length() > 4)
+          return false;
+        unsigned int value = 0;
+        for (unsigned int j = 0; j < parts[i].length(); ++j) {
+          const int d = hexDigit(parts[i][j]);
+          if (d < 0)
+            return false;
+          value = (value << 4) | d;
+        }
+        // scaled, rgb:f/f/f is white
+        rgb[i] = value * 0xffffu / ((1u << (parts[i].length() * 4)) - 1);
+      }
+    } else if (startsWith(spec, "rgbi:")) {
+      std::string parts[3];
+      if (!splitComponents(spec.substr(5), parts))
+        return false;
+      for (unsigned int i = 0; i < 3; ++i) {
+        char *end;
+        const double value = strtod(parts[i].c_str(), &end);
+        if (*end != '\0' || !(value >= 0.0 && value <= 1.0))
+          return false;
+        rgb[i] = static_cast<unsigned short>(value * 0xffff + 0.5);
+      }
+    } else {
+      int r, g, b;
+      if (!findColorName(spec, r, g, b))
+        return false;
+      rgb[0] = r * 0x101;
+      rgb[1] = g * 0x101;
+      rgb[2] = b * 0x101;
+    }
+
+    xcol.red   = rgb[0];
+    xcol.green = rgb[1];
+    xcol.blue  = rgb[2];
+    return true;
+  }
+
+} // namespace bt
+
+
 bt::Color bt::Color::namedColor(const Display &display, unsigned int screen,
                                 const std::string &colorname) {
   if (colorname.empty()) {
@@ -278,13 +781,19 @@ bt::Color bt::Color::namedColor(const Display &display, unsigned int screen,
   xcol.blue  = 0;
   xcol.pixel = 0;
 
+  // only unknown names and other color spaces need the server
   Colormap colormap = display.screenInfo(screen).colormap();
-  if (!XParseColor(display.XDisplay(), colormap, colorname.c_str(), &xcol)) {
+  if (!parseColor(colorname, xcol)
+      && !XParseColor(display.XDisplay(), colormap,
+                      colorname.c_str(), &xcol)) {
     fprintf(stderr, gettext("bt::Color::namedColor: invalid color '%s'\n"),
             colorname.c_str());
     return Color();
   }
 
+  if (colorcache)
+    colorcache->defer(screen, xcol.red >> 8, xcol.green >> 8, xcol.blue >> 8);
+
   return Color(xcol.red >> 8, xcol.green >> 8, xcol.blue >> 8);
 }
 
@@ -41,10 +41,22 @@ namespace bt {
   class Color {
   public:
     /*
-      Frees unused colors on all screens.
+      Frees unused colors on all screens.  Colors from the last
+      allocateDeferred() are kept until the following call, since they
+      are usually not drawn with yet.
      */
     static void clearCache(void);
 
+    /*
+      Defers allocating the colors returned by namedColor() until
+      allocateDeferred() is called, which allocates all of them at
+      once.  On writable colormaps this costs one server round trip
+      instead of one per color.  Used while loading a style.
+      tests/colors.cc measures this on a PseudoColor screen.
+    */
+    static void deferAllocation(void);
+    static void allocateDeferred(void);
+
     /*
       Returns the named color on the specified display and screen.  If
       the color couldn't be found, an invalid color is returned.
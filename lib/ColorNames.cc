@@ -0,0 +1,886 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; -*-
+// ColorNames.cc for Blackbox - an X11 Window manager
+// Copyright (c) 2001 - 2005 Sean 'Shaleh' Perry <shaleh at debian.org>
+// Copyright (c) 1997 - 2000, 2002 - 2005
+//         Bradley T Hughes <bhughes at trolltech.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+#include <string>
+
+
+namespace bt {
+
+  /*
+    The X11 named colors (rgb.txt), lower case, so that they can be
+    resolved without asking the server.
+
+    The table is a minimal perfect hash: a name's bucket is
+    colorNameHash(name, 0) % 256, and the name is found at
+    colorNameHash(name, displacements[bucket]) % 753.  The
+    displacements were found by trying seeds for the largest buckets
+    first until every name had its own slot.  Both tables are
+    generated by util/gencolornames.cc; to regenerate them run
+
+      make -C util gencolornames
+      util/gencolornames /usr/share/X11/rgb.txt
+
+    and replace the tables below with its output.
+  */
+  struct ColorName {
+    const char *name;
+    unsigned char red, green, blue;
+  };
+
+  static const unsigned short displacements[256] = {
+        9,     9,    11,    73,    13,    21,   100,     2,    22,    13,
+       30,     6,     0,    46,     4,     2,     0,    10,    28,    36,
+        8,    50,    26,     1,     2,     8,     3,     1,     2,    39,
+        0,     2,    26,     3,    12,     6,    15,     7,    40,     1,
+        3,     7,    43,    11,     1,     1,    33,     3,    54,     1,
+       13,    17,     1,    44,     1,     3,    62,     9,     5,    22,
+       17,    54,    12,     4,     2,    17,     2,     4,    38,     0,
+        0,     2,    25,     0,     8,     4,    35,    55,     3,    13,
+        8,    87,    24,    17,     3,    31,     1,    29,    32,    22,
+       84,    17,     1,     3,    21,    35,     6,   172,    45,    12,
+       21,    36,     2,     1,     6,    26,     5,    25,     1,    38,
+        4,    21,     1,   116,    10,    24,     2,     5,     3,     2,
+        1,    40,     9,     0,    25,    33,    24,    30,     4,    42,
+       40,     5,    33,    24,    12,    30,   222,     4,   128,     8,
+       91,     6,     6,     2,     0,     1,    19,     0,    29,     1,
+        0,    21,    42,   103,   100,     4,    50,    86,    10,    68,
+       78,    49,     9,     1,     1,    56,     6,    12,    29,    21,
+       64,     3,     2,    31,     4,     1,     1,   106,    37,    11,
+       19,     5,     7,     2,     4,     5,     0,     0,    19,   257,
+       80,     1,    94,     5,     3,     1,    27,    74,     5,     0,
+       62,   179,     8,    37,    35,     0,    79,   190,    50,     4,
+       14,    81,   105,   141,    17,   131,     3,     6,   129,     0,
+      128,    20,     1,    68,     4,    12,   108,    56,   237,    10,
+       18,     4,   126,   137,    16,     3,    50,    61,    73,   182,
+        6,     1,   101,   799,   292,   282,   260,    53,   244,     9,
+        4,     1,    41,   151,     1,   151,
+  };
+
+  static const ColorName color_names[753] = {
+    { "slate blue", 106, 90, 205 },
+    { "lightyellow3", 205, 205, 180 },
+    { "grey74", 189, 189, 189 },
+    { "red", 255, 0, 0 },
+    { "lightpink2", 238, 162, 173 },
+    { "orange3", 205, 133, 0 },
+    { "darkgray", 169, 169, 169 },
+    { "red4", 139, 0, 0 },
+    { "lightcyan1", 224, 255, 255 },
+    { "grey3", 8, 8, 8 },
+    { "lightskyblue4", 96, 123, 139 },
+    { "tan3", 205, 133, 63 },
+    { "aliceblue", 240, 248, 255 },
+    { "indianred4", 139, 58, 58 },
+    { "grey43", 110, 110, 110 },
+    { "grey54", 138, 138, 138 },
+    { "antiquewhite3", 205, 192, 176 },
+    { "gray26", 66, 66, 66 },
+    { "mediumblue", 0, 0, 205 },
+    { "maroon", 176, 48, 96 },
+    { "hotpink", 255, 105, 180 },
+    { "navajowhite2", 238, 207, 161 },
+    { "green", 0, 255, 0 },
+    { "gray29", 74, 74, 74 },
+    { "lavenderblush", 255, 240, 245 },
+    { "greenyellow", 173, 255, 47 },
+    { "dodgerblue4", 16, 78, 139 },
+    { "thistle1", 255, 225, 255 },
+    { "dark green", 0, 100, 0 },
+    { "mediumorchid1", 224, 102, 255 },
+    { "lightyellow", 255, 255, 224 },
+    { "mistyrose1", 255, 228, 225 },
+    { "hot pink", 255, 105, 180 },
+    { "antiquewhite", 250, 235, 215 },
+    { "gray79", 201, 201, 201 },
+    { "gold3", 205, 173, 0 },
+    { "orange", 255, 165, 0 },
+    { "light goldenrod yellow", 250, 250, 210 },
+    { "gray32", 82, 82, 82 },
+    { "gray5", 13, 13, 13 },
+    { "seagreen1", 84, 255, 159 },
+    { "yellow", 255, 255, 0 },
+    { "orangered1", 255, 69, 0 },
+    { "magenta4", 139, 0, 139 },
+    { "dodger blue", 30, 144, 255 },
+    { "gold1", 255, 215, 0 },
+    { "azure4", 131, 139, 139 },
+    { "palegreen3", 124, 205, 124 },
+    { "white", 255, 255, 255 },
+    { "medium violet red", 199, 21, 133 },
+    { "grey91", 232, 232, 232 },
+    { "steelblue1", 99, 184, 255 },
+    { "grey63", 161, 161, 161 },
+    { "linen", 250, 240, 230 },
+    { "slategray2", 185, 211, 238 },
+    { "violetred4", 139, 34, 82 },
+    { "grey2", 5, 5, 5 },
+    { "lightsalmon", 255, 160, 122 },
+    { "dodgerblue", 30, 144, 255 },
+    { "darkorchid4", 104, 34, 139 },
+    { "slategray3", 159, 182, 205 },
+    { "grey93", 237, 237, 237 },
+    { "lightskyblue2", 164, 211, 238 },
+    { "mistyrose", 255, 228, 225 },
+    { "seashell4", 139, 134, 130 },
+    { "antiquewhite4", 139, 131, 120 },
+    { "grey19", 48, 48, 48 },
+    { "gray59", 150, 150, 150 },
+    { "grey38", 97, 97, 97 },
+    { "lemonchiffon2", 238, 233, 191 },
+    { "brown2", 238, 59, 59 },
+    { "maroon2", 238, 48, 167 },
+    { "grey23", 59, 59, 59 },
+    { "goldenrod1", 255, 193, 37 },
+    { "darkslategray1", 151, 255, 255 },
+    { "orchid2", 238, 122, 233 },
+    { "forest green", 34, 139, 34 },
+    { "dark blue", 0, 0, 139 },
+    { "mediumspringgreen", 0, 250, 154 },
+    { "chartreuse", 127, 255, 0 },
+    { "cyan", 0, 255, 255 },
+    { "chartreuse1", 127, 255, 0 },
+    { "gray66", 168, 168, 168 },
+    { "grey14", 36, 36, 36 },
+    { "lemon chiffon", 255, 250, 205 },
+    { "indianred2", 238, 99, 99 },
+    { "darkslategray4", 82, 139, 139 },
+    { "springgreen4", 0, 139, 69 },
+    { "slate gray", 112, 128, 144 },
+    { "lightslateblue", 132, 112, 255 },
+    { "mistyrose3", 205, 183, 181 },
+    { "hotpink4", 139, 58, 98 },
+    { "gray25", 64, 64, 64 },
+    { "gray15", 38, 38, 38 },
+    { "lightskyblue1", 176, 226, 255 },
+    { "lightslategray", 119, 136, 153 },
+    { "grey18", 46, 46, 46 },
+    { "gray85", 217, 217, 217 },
+    { "light slate grey", 119, 136, 153 },
+    { "dark salmon", 233, 150, 122 },
+    { "light yellow", 255, 255, 224 },
+    { "ghost white", 248, 248, 255 },
+    { "orchid3", 205, 105, 201 },
+    { "mint cream", 245, 255, 250 },
+    { "rosybrown", 188, 143, 143 },
+    { "lightyellow1", 255, 255, 224 },
+    { "yellow1", 255, 255, 0 },
+    { "darkseagreen1", 193, 255, 193 },
+    { "blue", 0, 0, 255 },
+    { "gray87", 222, 222, 222 },
+    { "gray60", 153, 153, 153 },
+    { "bisque", 255, 228, 196 },
+    { "alice blue", 240, 248, 255 },
+    { "palevioletred4", 139, 71, 93 },
+    { "slategray4", 108, 123, 139 },
+    { "darkgoldenrod1", 255, 185, 15 },
+    { "medium aquamarine", 102, 205, 170 },
+    { "lavender", 230, 230, 250 },
+    { "aquamarine1", 127, 255, 212 },
+    { "yellowgreen", 154, 205, 50 },
+    { "mediumpurple1", 171, 130, 255 },
+    { "plum3", 205, 150, 205 },
+    { "grey51", 130, 130, 130 },
+    { "khaki1", 255, 246, 143 },
+    { "sienna4", 139, 71, 38 },
+    { "skyblue1", 135, 206, 255 },
+    { "grey30", 77, 77, 77 },
+    { "slateblue2", 122, 103, 238 },
+    { "lightsalmon1", 255, 160, 122 },
+    { "orchid4", 139, 71, 137 },
+    { "skyblue3", 108, 166, 205 },
+    { "saddlebrown", 139, 69, 19 },
+    { "aquamarine4", 69, 139, 116 },
+    { "grey89", 227, 227, 227 },
+    { "lightslategrey", 119, 136, 153 },
+    { "gold4", 139, 117, 0 },
+    { "royalblue", 65, 105, 225 },
+    { "springgreen", 0, 255, 127 },
+    { "orange4", 139, 90, 0 },
+    { "purple2", 145, 44, 238 },
+    { "grey9", 23, 23, 23 },
+    { "seagreen3", 67, 205, 128 },
+    { "wheat4", 139, 126, 102 },
+    { "peachpuff3", 205, 175, 149 },
+    { "darkslategray3", 121, 205, 205 },
+    { "tan1", 255, 165, 79 },
+    { "slateblue4", 71, 60, 139 },
+    { "turquoise2", 0, 229, 238 },
+    { "sandy brown", 244, 164, 96 },
+    { "grey35", 89, 89, 89 },
+    { "gray83", 212, 212, 212 },
+    { "darkolivegreen3", 162, 205, 90 },
+    { "darkred", 139, 0, 0 },
+    { "tan4", 139, 90, 43 },
+    { "azure1", 240, 255, 255 },
+    { "midnight blue", 25, 25, 112 },
+    { "darkorange3", 205, 102, 0 },
+    { "deepskyblue3", 0, 154, 205 },
+    { "cyan1", 0, 255, 255 },
+    { "cornsilk3", 205, 200, 177 },
+    { "gray97", 247, 247, 247 },
+    { "gray23", 59, 59, 59 },
+    { "mistyrose2", 238, 213, 210 },
+    { "sienna1", 255, 130, 71 },
+    { "wheat3", 205, 186, 150 },
+    { "bisque2", 238, 213, 183 },
+    { "light pink", 255, 182, 193 },
+    { "navajowhite1", 255, 222, 173 },
+    { "burlywood", 222, 184, 135 },
+    { "darkgoldenrod3", 205, 149, 12 },
+    { "deeppink1", 255, 20, 147 },
+    { "darkorange4", 139, 69, 0 },
+    { "cadetblue", 95, 158, 160 },
+    { "cornflowerblue", 100, 149, 237 },
+    { "grey31", 79, 79, 79 },
+    { "lawngreen", 124, 252, 0 },
+    { "slateblue1", 131, 111, 255 },
+    { "brown1", 255, 64, 64 },
+    { "coral4", 139, 62, 47 },
+    { "medium slate blue", 123, 104, 238 },
+    { "wheat2", 238, 216, 174 },
+    { "forestgreen", 34, 139, 34 },
+    { "violet", 238, 130, 238 },
+    { "gray50", 127, 127, 127 },
+    { "grey47", 120, 120, 120 },
+    { "maroon3", 205, 41, 144 },
+    { "grey72", 184, 184, 184 },
+    { "skyblue", 135, 206, 235 },
+    { "azure3", 193, 205, 205 },
+    { "cadet blue", 95, 158, 160 },
+    { "mediumpurple2", 159, 121, 238 },
+    { "steelblue2", 92, 172, 238 },
+    { "grey22", 56, 56, 56 },
+    { "chartreuse4", 69, 139, 0 },
+    { "hotpink1", 255, 110, 180 },
+    { "gray38", 97, 97, 97 },
+    { "gray90", 229, 229, 229 },
+    { "red1", 255, 0, 0 },
+    { "grey28", 71, 71, 71 },
+    { "pale turquoise", 175, 238, 238 },
+    { "firebrick2", 238, 44, 44 },
+    { "medium turquoise", 72, 209, 204 },
+    { "palegreen1", 154, 255, 154 },
+    { "darkorange2", 238, 118, 0 },
+    { "gray43", 110, 110, 110 },
+    { "grey59", 150, 150, 150 },
+    { "salmon4", 139, 76, 57 },
+    { "violetred", 208, 32, 144 },
+    { "brown", 165, 42, 42 },
+    { "lightsteelblue1", 202, 225, 255 },
+    { "lightpink1", 255, 174, 185 },
+    { "gray16", 41, 41, 41 },
+    { "papaya whip", 255, 239, 213 },
+    { "purple", 160, 32, 240 },
+    { "grey86", 219, 219, 219 },
+    { "olivedrab", 107, 142, 35 },
+    { "grey7", 18, 18, 18 },
+    { "midnightblue", 25, 25, 112 },
+    { "dark cyan", 0, 139, 139 },
+    { "gray46", 117, 117, 117 },
+    { "light grey", 211, 211, 211 },
+    { "snow2", 238, 233, 233 },
+    { "goldenrod3", 205, 155, 29 },
+    { "dark magenta", 139, 0, 139 },
+    { "ivory1", 255, 255, 240 },
+    { "gray27", 69, 69, 69 },
+    { "darkseagreen3", 155, 205, 155 },
+    { "grey32", 82, 82, 82 },
+    { "gray89", 227, 227, 227 },
+    { "navajowhite4", 139, 121, 94 },
+    { "firebrick", 178, 34, 34 },
+    { "grey76", 194, 194, 194 },
+    { "gray45", 115, 115, 115 },
+    { "dodgerblue1", 30, 144, 255 },
+    { "thistle3", 205, 181, 205 },
+    { "tomato", 255, 99, 71 },
+    { "cyan2", 0, 238, 238 },
+    { "green4", 0, 139, 0 },
+    { "peach puff", 255, 218, 185 },
+    { "mediumorchid2", 209, 95, 238 },
+    { "seashell2", 238, 229, 222 },
+    { "honeydew1", 240, 255, 240 },
+    { "turquoise4", 0, 134, 139 },
+    { "dodgerblue2", 28, 134, 238 },
+    { "lemonchiffon4", 139, 137, 112 },
+    { "slategray", 112, 128, 144 },
+    { "gray84", 214, 214, 214 },
+    { "tomato3", 205, 79, 57 },
+    { "grey60", 153, 153, 153 },
+    { "orchid", 218, 112, 214 },
+    { "paleturquoise", 175, 238, 238 },
+    { "mediumorchid3", 180, 82, 205 },
+    { "grey42", 107, 107, 107 },
+    { "dark khaki", 189, 183, 107 },
+    { "gray67", 171, 171, 171 },
+    { "peru", 205, 133, 63 },
+    { "mistyrose4", 139, 125, 123 },
+    { "gray14", 36, 36, 36 },
+    { "darkblue", 0, 0, 139 },
+    { "grey16", 41, 41, 41 },
+    { "navyblue", 0, 0, 128 },
+    { "seagreen", 46, 139, 87 },
+    { "snow", 255, 250, 250 },
+    { "firebrick3", 205, 38, 38 },
+    { "mediumaquamarine", 102, 205, 170 },
+    { "grey11", 28, 28, 28 },
+    { "burlywood4", 139, 115, 85 },
+    { "plum1", 255, 187, 255 },
+    { "sea green", 46, 139, 87 },
+    { "coral3", 205, 91, 69 },
+    { "palegreen4", 84, 139, 84 },
+    { "saddle brown", 139, 69, 19 },
+    { "lightgray", 211, 211, 211 },
+    { "orangered3", 205, 55, 0 },
+    { "mediumvioletred", 199, 21, 133 },
+    { "gray51", 130, 130, 130 },
+    { "grey17", 43, 43, 43 },
+    { "light slate gray", 119, 136, 153 },
+    { "lemonchiffon", 255, 250, 205 },
+    { "grey33", 84, 84, 84 },
+    { "darkolivegreen1", 202, 255, 112 },
+    { "gray96", 245, 245, 245 },
+    { "grey0", 0, 0, 0 },
+    { "grey25", 64, 64, 64 },
+    { "gray24", 61, 61, 61 },
+    { "blue2", 0, 0, 238 },
+    { "coral2", 238, 106, 80 },
+    { "floralwhite", 255, 250, 240 },
+    { "gray55", 140, 140, 140 },
+    { "lightgoldenrodyellow", 250, 250, 210 },
+    { "rosybrown2", 238, 180, 180 },
+    { "burlywood1", 255, 211, 155 },
+    { "lightpink3", 205, 140, 149 },
+    { "gray31", 79, 79, 79 },
+    { "grey69", 176, 176, 176 },
+    { "gray73", 186, 186, 186 },
+    { "darkorchid", 153, 50, 204 },
+    { "lime green", 50, 205, 50 },
+    { "gray78", 199, 199, 199 },
+    { "gray95", 242, 242, 242 },
+    { "gray49", 125, 125, 125 },
+    { "darkolivegreen", 85, 107, 47 },
+    { "gray53", 135, 135, 135 },
+    { "dark orange", 255, 140, 0 },
+    { "lightyellow4", 139, 139, 122 },
+    { "rosybrown3", 205, 155, 155 },
+    { "lightblue1", 191, 239, 255 },
+    { "gray48", 122, 122, 122 },
+    { "lightsteelblue2", 188, 210, 238 },
+    { "sienna3", 205, 104, 57 },
+    { "springgreen2", 0, 238, 118 },
+    { "magenta", 255, 0, 255 },
+    { "violet red", 208, 32, 144 },
+    { "darkslategray", 47, 79, 79 },
+    { "royalblue2", 67, 110, 238 },
+    { "darkslateblue", 72, 61, 139 },
+    { "violetred3", 205, 50, 120 },
+    { "salmon1", 255, 140, 105 },
+    { "lightcyan4", 122, 139, 139 },
+    { "peachpuff2", 238, 203, 173 },
+    { "lemonchiffon3", 205, 201, 165 },
+    { "slate grey", 112, 128, 144 },
+    { "salmon", 250, 128, 114 },
+    { "gray1", 3, 3, 3 },
+    { "lightcyan3", 180, 205, 205 },
+    { "olivedrab1", 192, 255, 62 },
+    { "navy blue", 0, 0, 128 },
+    { "cadetblue3", 122, 197, 205 },
+    { "lightsalmon3", 205, 129, 98 },
+    { "gray70", 179, 179, 179 },
+    { "seagreen2", 78, 238, 148 },
+    { "dimgray", 105, 105, 105 },
+    { "grey98", 250, 250, 250 },
+    { "seagreen4", 46, 139, 87 },
+    { "rosy brown", 188, 143, 143 },
+    { "yellow4", 139, 139, 0 },
+    { "rosybrown1", 255, 193, 193 },
+    { "lightgoldenrod1", 255, 236, 139 },
+    { "chocolate2", 238, 118, 33 },
+    { "darkorchid1", 191, 62, 255 },
+    { "darkviolet", 148, 0, 211 },
+    { "chocolate1", 255, 127, 36 },
+    { "paleturquoise4", 102, 139, 139 },
+    { "gray9", 23, 23, 23 },
+    { "darkgrey", 169, 169, 169 },
+    { "red3", 205, 0, 0 },
+    { "blanched almond", 255, 235, 205 },
+    { "grey24", 61, 61, 61 },
+    { "lightpink", 255, 182, 193 },
+    { "grey39", 99, 99, 99 },
+    { "grey81", 207, 207, 207 },
+    { "antique white", 250, 235, 215 },
+    { "deep pink", 255, 20, 147 },
+    { "turquoise", 64, 224, 208 },
+    { "gray6", 15, 15, 15 },
+    { "thistle2", 238, 210, 238 },
+    { "darkolivegreen4", 110, 139, 61 },
+    { "royalblue4", 39, 64, 139 },
+    { "blue4", 0, 0, 139 },
+    { "grey88", 224, 224, 224 },
+    { "lightskyblue", 135, 206, 250 },
+    { "dark orchid", 153, 50, 204 },
+    { "plum4", 139, 102, 139 },
+    { "gray91", 232, 232, 232 },
+    { "lavenderblush2", 238, 224, 229 },
+    { "gray63", 161, 161, 161 },
+    { "lavenderblush3", 205, 193, 197 },
+    { "gray100", 255, 255, 255 },
+    { "grey46", 117, 117, 117 },
+    { "grey78", 199, 199, 199 },
+    { "debianred", 215, 7, 81 },
+    { "snow1", 255, 250, 250 },
+    { "lightsalmon2", 238, 149, 114 },
+    { "grey84", 214, 214, 214 },
+    { "royal blue", 65, 105, 225 },
+    { "grey53", 135, 135, 135 },
+    { "gray98", 250, 250, 250 },
+    { "lightgoldenrod", 238, 221, 130 },
+    { "dark violet", 148, 0, 211 },
+    { "grey85", 217, 217, 217 },
+    { "green1", 0, 255, 0 },
+    { "lavender blush", 255, 240, 245 },
+    { "limegreen", 50, 205, 50 },
+    { "aquamarine3", 102, 205, 170 },
+    { "slateblue3", 105, 89, 205 },
+    { "chartreuse2", 118, 238, 0 },
+    { "peachpuff4", 139, 119, 101 },
+    { "grey67", 171, 171, 171 },
+    { "coral", 255, 127, 80 },
+    { "plum2", 238, 174, 238 },
+    { "darkorange", 255, 140, 0 },
+    { "plum", 221, 160, 221 },
+    { "gray76", 194, 194, 194 },
+    { "gray68", 173, 173, 173 },
+    { "grey5", 13, 13, 13 },
+    { "firebrick1", 255, 48, 48 },
+    { "gray82", 209, 209, 209 },
+    { "grey99", 252, 252, 252 },
+    { "grey27", 69, 69, 69 },
+    { "gray65", 166, 166, 166 },
+    { "hotpink2", 238, 106, 167 },
+    { "steelblue3", 79, 148, 205 },
+    { "blue violet", 138, 43, 226 },
+    { "grey97", 247, 247, 247 },
+    { "sky blue", 135, 206, 235 },
+    { "powder blue", 176, 224, 230 },
+    { "mintcream", 245, 255, 250 },
+    { "gray17", 43, 43, 43 },
+    { "gray13", 33, 33, 33 },
+    { "sienna2", 238, 121, 66 },
+    { "grey95", 242, 242, 242 },
+    { "gray88", 224, 224, 224 },
+    { "salmon2", 238, 130, 98 },
+    { "grey64", 163, 163, 163 },
+    { "gray20", 51, 51, 51 },
+    { "light green", 144, 238, 144 },
+    { "grey83", 212, 212, 212 },
+    { "grey65", 166, 166, 166 },
+    { "aquamarine2", 118, 238, 198 },
+    { "mediumpurple3", 137, 104, 205 },
+    { "gray22", 56, 56, 56 },
+    { "pale green", 152, 251, 152 },
+    { "dim gray", 105, 105, 105 },
+    { "azure", 240, 255, 255 },
+    { "khaki4", 139, 134, 78 },
+    { "grey62", 158, 158, 158 },
+    { "oldlace", 253, 245, 230 },
+    { "grey73", 186, 186, 186 },
+    { "sienna", 160, 82, 45 },
+    { "seashell1", 255, 245, 238 },
+    { "gray58", 148, 148, 148 },
+    { "grey34", 87, 87, 87 },
+    { "navajo white", 255, 222, 173 },
+    { "bisque4", 139, 125, 107 },
+    { "pink3", 205, 145, 158 },
+    { "gray92", 235, 235, 235 },
+    { "gray86", 219, 219, 219 },
+    { "green yellow", 173, 255, 47 },
+    { "indian red", 205, 92, 92 },
+    { "yellow2", 238, 238, 0 },
+    { "rosybrown4", 139, 105, 105 },
+    { "indianred1", 255, 106, 106 },
+    { "light coral", 240, 128, 128 },
+    { "pale goldenrod", 238, 232, 170 },
+    { "goldenrod2", 238, 180, 34 },
+    { "mediumslateblue", 123, 104, 238 },
+    { "chartreuse3", 102, 205, 0 },
+    { "medium orchid", 186, 85, 211 },
+    { "darkturquoise", 0, 206, 209 },
+    { "grey41", 105, 105, 105 },
+    { "darkcyan", 0, 139, 139 },
+    { "honeydew3", 193, 205, 193 },
+    { "grey52", 133, 133, 133 },
+    { "pink2", 238, 169, 184 },
+    { "gray34", 87, 87, 87 },
+    { "deep sky blue", 0, 191, 255 },
+    { "ivory4", 139, 139, 131 },
+    { "darkmagenta", 139, 0, 139 },
+    { "gray81", 207, 207, 207 },
+    { "red2", 238, 0, 0 },
+    { "cornsilk4", 139, 136, 120 },
+    { "dark turquoise", 0, 206, 209 },
+    { "darkseagreen4", 105, 139, 105 },
+    { "grey44", 112, 112, 112 },
+    { "paleturquoise3", 150, 205, 205 },
+    { "steelblue4", 54, 100, 139 },
+    { "thistle", 216, 191, 216 },
+    { "wheat", 245, 222, 179 },
+    { "palevioletred2", 238, 121, 159 },
+    { "grey66", 168, 168, 168 },
+    { "gray", 190, 190, 190 },
+    { "tomato4", 139, 54, 38 },
+    { "lightskyblue3", 141, 182, 205 },
+    { "grey82", 209, 209, 209 },
+    { "gray41", 105, 105, 105 },
+    { "chocolate", 210, 105, 30 },
+    { "springgreen3", 0, 205, 102 },
+    { "gray11", 28, 28, 28 },
+    { "bisque3", 205, 183, 158 },
+    { "green3", 0, 205, 0 },
+    { "medium sea green", 60, 179, 113 },
+    { "gray56", 143, 143, 143 },
+    { "palegoldenrod", 238, 232, 170 },
+    { "ivory2", 238, 238, 224 },
+    { "grey68", 173, 173, 173 },
+    { "floral white", 255, 250, 240 },
+    { "deeppink4", 139, 10, 80 },
+    { "deepskyblue2", 0, 178, 238 },
+    { "gray54", 138, 138, 138 },
+    { "lightgoldenrod4", 139, 129, 76 },
+    { "gray61", 156, 156, 156 },
+    { "lavenderblush4", 139, 131, 134 },
+    { "honeydew2", 224, 238, 224 },
+    { "palevioletred1", 255, 130, 171 },
+    { "burlywood3", 205, 170, 125 },
+    { "gray57", 145, 145, 145 },
+    { "dim grey", 105, 105, 105 },
+    { "cadetblue1", 152, 245, 255 },
+    { "grey77", 196, 196, 196 },
+    { "palevioletred", 219, 112, 147 },
+    { "grey21", 54, 54, 54 },
+    { "gray33", 84, 84, 84 },
+    { "tan2", 238, 154, 73 },
+    { "darkorchid2", 178, 58, 238 },
+    { "navajowhite3", 205, 179, 139 },
+    { "lightgoldenrod3", 205, 190, 112 },
+    { "gray0", 0, 0, 0 },
+    { "grey61", 156, 156, 156 },
+    { "grey96", 245, 245, 245 },
+    { "light sea green", 32, 178, 170 },
+    { "orangered4", 139, 37, 0 },
+    { "deepskyblue4", 0, 104, 139 },
+    { "dark red", 139, 0, 0 },
+    { "gray94", 240, 240, 240 },
+    { "skyblue2", 126, 192, 238 },
+    { "misty rose", 255, 228, 225 },
+    { "brown3", 205, 51, 51 },
+    { "olivedrab3", 154, 205, 50 },
+    { "lemonchiffon1", 255, 250, 205 },
+    { "snow4", 139, 137, 137 },
+    { "lightcyan2", 209, 238, 238 },
+    { "mediumturquoise", 72, 209, 204 },
+    { "chocolate3", 205, 102, 29 },
+    { "gray47", 120, 120, 120 },
+    { "grey12", 31, 31, 31 },
+    { "lightblue", 173, 216, 230 },
+    { "gray35", 89, 89, 89 },
+    { "steel blue", 70, 130, 180 },
+    { "salmon3", 205, 112, 84 },
+    { "grey57", 145, 145, 145 },
+    { "grey50", 127, 127, 127 },
+    { "mediumorchid", 186, 85, 211 },
+    { "gray4", 10, 10, 10 },
+    { "khaki2", 238, 230, 133 },
+    { "gray19", 48, 48, 48 },
+    { "medium blue", 0, 0, 205 },
+    { "darkgoldenrod4", 139, 101, 8 },
+    { "violetred2", 238, 58, 140 },
+    { "paleturquoise2", 174, 238, 238 },
+    { "firebrick4", 139, 26, 26 },
+    { "papayawhip", 255, 239, 213 },
+    { "gray77", 196, 196, 196 },
+    { "yellow3", 205, 205, 0 },
+    { "bisque1", 255, 228, 196 },
+    { "coral1", 255, 114, 86 },
+    { "purple3", 125, 38, 205 },
+    { "gray44", 112, 112, 112 },
+    { "old lace", 253, 245, 230 },
+    { "medium spring green", 0, 250, 154 },
+    { "maroon4", 139, 28, 98 },
+    { "lightsteelblue4", 110, 123, 139 },
+    { "grey55", 140, 140, 140 },
+    { "grey87", 222, 222, 222 },
+    { "light gray", 211, 211, 211 },
+    { "pink1", 255, 181, 197 },
+    { "gray3", 8, 8, 8 },
+    { "pink4", 139, 99, 108 },
+    { "hotpink3", 205, 96, 144 },
+    { "deeppink3", 205, 16, 118 },
+    { "grey58", 148, 148, 148 },
+    { "deeppink", 255, 20, 147 },
+    { "grey79", 201, 201, 201 },
+    { "grey45", 115, 115, 115 },
+    { "darkorchid3", 154, 50, 205 },
+    { "light slate blue", 132, 112, 255 },
+    { "tomato1", 255, 99, 71 },
+    { "magenta2", 238, 0, 238 },
+    { "indianred", 205, 92, 92 },
+    { "darkorange1", 255, 127, 0 },
+    { "dark gray", 169, 169, 169 },
+    { "lightblue2", 178, 223, 238 },
+    { "antiquewhite1", 255, 239, 219 },
+    { "orange1", 255, 165, 0 },
+    { "mediumpurple4", 93, 71, 139 },
+    { "deepskyblue", 0, 191, 255 },
+    { "royalblue1", 72, 118, 255 },
+    { "gray8", 20, 20, 20 },
+    { "honeydew", 240, 255, 240 },
+    { "peachpuff", 255, 218, 185 },
+    { "gray72", 184, 184, 184 },
+    { "gray36", 92, 92, 92 },
+    { "ivory", 255, 255, 240 },
+    { "turquoise3", 0, 197, 205 },
+    { "gray93", 237, 237, 237 },
+    { "steelblue", 70, 130, 180 },
+    { "dark slate blue", 72, 61, 139 },
+    { "cornsilk", 255, 248, 220 },
+    { "antiquewhite2", 238, 223, 204 },
+    { "gray12", 31, 31, 31 },
+    { "slategrey", 112, 128, 144 },
+    { "gainsboro", 220, 220, 220 },
+    { "orchid1", 255, 131, 250 },
+    { "navy", 0, 0, 128 },
+    { "grey71", 181, 181, 181 },
+    { "cyan3", 0, 205, 205 },
+    { "lightsteelblue3", 162, 181, 205 },
+    { "white smoke", 245, 245, 245 },
+    { "gray40", 102, 102, 102 },
+    { "ivory3", 205, 205, 193 },
+    { "palevioletred3", 205, 104, 137 },
+    { "light salmon", 255, 160, 122 },
+    { "blueviolet", 138, 43, 226 },
+    { "springgreen1", 0, 255, 127 },
+    { "gray7", 18, 18, 18 },
+    { "khaki", 240, 230, 140 },
+    { "lightgrey", 211, 211, 211 },
+    { "grey1", 3, 3, 3 },
+    { "lightblue4", 104, 131, 139 },
+    { "grey", 190, 190, 190 },
+    { "light steel blue", 176, 196, 222 },
+    { "orangered2", 238, 64, 0 },
+    { "darkseagreen", 143, 188, 143 },
+    { "grey80", 204, 204, 204 },
+    { "mediumseagreen", 60, 179, 113 },
+    { "khaki3", 205, 198, 115 },
+    { "grey40", 102, 102, 102 },
+    { "lightgreen", 144, 238, 144 },
+    { "dodgerblue3", 24, 116, 205 },
+    { "cornsilk2", 238, 232, 205 },
+    { "tomato2", 238, 92, 66 },
+    { "gray21", 54, 54, 54 },
+    { "turquoise1", 0, 245, 255 },
+    { "grey36", 92, 92, 92 },
+    { "grey49", 125, 125, 125 },
+    { "paleturquoise1", 187, 255, 255 },
+    { "darkslategray2", 141, 238, 238 },
+    { "gray99", 252, 252, 252 },
+    { "gray2", 5, 5, 5 },
+    { "grey56", 143, 143, 143 },
+    { "grey4", 10, 10, 10 },
+    { "grey20", 51, 51, 51 },
+    { "goldenrod", 218, 165, 32 },
+    { "grey75", 191, 191, 191 },
+    { "dark slate grey", 47, 79, 79 },
+    { "grey6", 15, 15, 15 },
+    { "brown4", 139, 35, 35 },
+    { "dark sea green", 143, 188, 143 },
+    { "purple4", 85, 26, 139 },
+    { "lightsalmon4", 139, 87, 66 },
+    { "thistle4", 139, 123, 139 },
+    { "goldenrod4", 139, 105, 20 },
+    { "grey15", 38, 38, 38 },
+    { "blue3", 0, 0, 205 },
+    { "palegreen", 152, 251, 152 },
+    { "gray62", 158, 158, 158 },
+    { "darkgoldenrod", 184, 134, 11 },
+    { "orange2", 238, 154, 0 },
+    { "grey29", 74, 74, 74 },
+    { "mediumorchid4", 122, 55, 139 },
+    { "cornflower blue", 100, 149, 237 },
+    { "darkgoldenrod2", 238, 173, 14 },
+    { "lightyellow2", 238, 238, 209 },
+    { "sandybrown", 244, 164, 96 },
+    { "slateblue", 106, 90, 205 },
+    { "gray42", 107, 107, 107 },
+    { "gray52", 133, 133, 133 },
+    { "gray37", 94, 94, 94 },
+    { "pink", 255, 192, 203 },
+    { "darkslategrey", 47, 79, 79 },
+    { "lightcyan", 224, 255, 255 },
+    { "gray30", 77, 77, 77 },
+    { "chocolate4", 139, 69, 19 },
+    { "grey70", 179, 179, 179 },
+    { "darksalmon", 233, 150, 122 },
+    { "lavenderblush1", 255, 240, 245 },
+    { "yellow green", 154, 205, 50 },
+    { "magenta1", 255, 0, 255 },
+    { "royalblue3", 58, 95, 205 },
+    { "grey37", 94, 94, 94 },
+    { "gray64", 163, 163, 163 },
+    { "dimgrey", 105, 105, 105 },
+    { "gray28", 71, 71, 71 },
+    { "grey92", 235, 235, 235 },
+    { "darkgreen", 0, 100, 0 },
+    { "gray39", 99, 99, 99 },
+    { "grey10", 26, 26, 26 },
+    { "dark slate gray", 47, 79, 79 },
+    { "olivedrab4", 105, 139, 34 },
+    { "deeppink2", 238, 18, 137 },
+    { "tan", 210, 180, 140 },
+    { "dark goldenrod", 184, 134, 11 },
+    { "lightpink4", 139, 95, 101 },
+    { "gray10", 26, 26, 26 },
+    { "orangered", 255, 69, 0 },
+    { "grey26", 66, 66, 66 },
+    { "purple1", 155, 48, 255 },
+    { "gray74", 189, 189, 189 },
+    { "honeydew4", 131, 139, 131 },
+    { "spring green", 0, 255, 127 },
+    { "gray80", 204, 204, 204 },
+    { "burlywood2", 238, 197, 145 },
+    { "darkkhaki", 189, 183, 107 },
+    { "blue1", 0, 0, 255 },
+    { "snow3", 205, 201, 201 },
+    { "lawn green", 124, 252, 0 },
+    { "pale violet red", 219, 112, 147 },
+    { "lightblue3", 154, 192, 205 },
+    { "aquamarine", 127, 255, 212 },
+    { "gold", 255, 215, 0 },
+    { "grey94", 240, 240, 240 },
+    { "maroon1", 255, 52, 179 },
+    { "azure2", 224, 238, 238 },
+    { "seashell", 255, 245, 238 },
+    { "gray69", 176, 176, 176 },
+    { "grey90", 229, 229, 229 },
+    { "cadetblue2", 142, 229, 238 },
+    { "peachpuff1", 255, 218, 185 },
+    { "lightgoldenrod2", 238, 220, 130 },
+    { "black", 0, 0, 0 },
+    { "light sky blue", 135, 206, 250 },
+    { "mediumpurple", 147, 112, 219 },
+    { "gray18", 46, 46, 46 },
+    { "lightsteelblue", 176, 196, 222 },
+    { "darkolivegreen2", 188, 238, 104 },
+    { "cyan4", 0, 139, 139 },
+    { "grey48", 122, 122, 122 },
+    { "blanchedalmond", 255, 235, 205 },
+    { "grey100", 255, 255, 255 },
+    { "powderblue", 176, 224, 230 },
+    { "light cyan", 224, 255, 255 },
+    { "gray71", 181, 181, 181 },
+    { "indianred3", 205, 85, 85 },
+    { "deepskyblue1", 0, 191, 255 },
+    { "grey13", 33, 33, 33 },
+    { "ghostwhite", 248, 248, 255 },
+    { "grey8", 20, 20, 20 },
+    { "skyblue4", 74, 112, 139 },
+    { "palegreen2", 144, 238, 144 },
+    { "gray75", 191, 191, 191 },
+    { "light goldenrod", 238, 221, 130 },
+    { "darkseagreen2", 180, 238, 180 },
+    { "lightcoral", 240, 128, 128 },
+    { "lightseagreen", 32, 178, 170 },
+    { "dark olive green", 85, 107, 47 },
+    { "seashell3", 205, 197, 191 },
+    { "magenta3", 205, 0, 205 },
+    { "slategray1", 198, 226, 255 },
+    { "beige", 245, 245, 220 },
+    { "navajowhite", 255, 222, 173 },
+    { "green2", 0, 238, 0 },
+    { "medium purple", 147, 112, 219 },
+    { "orange red", 255, 69, 0 },
+    { "light blue", 173, 216, 230 },
+    { "cornsilk1", 255, 248, 220 },
+    { "whitesmoke", 245, 245, 245 },
+    { "olive drab", 107, 142, 35 },
+    { "gold2", 238, 201, 0 },
+    { "cadetblue4", 83, 134, 139 },
+    { "moccasin", 255, 228, 181 },
+    { "dark grey", 169, 169, 169 },
+    { "olivedrab2", 179, 238, 58 },
+    { "wheat1", 255, 231, 186 },
+    { "violetred1", 255, 62, 150 },
+  };
+
+
+  // FNV-1a of the lower case name, then mixed
+  static unsigned int colorNameHash(const std::string &name,
+                                    unsigned int seed) {
+    unsigned int hash = 2166136261u ^ seed;
+    for (std::string::size_type i = 0; i < name.length(); ++i) {
+      unsigned char c = name[i];
+      if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+      hash ^= c;
+      hash *= 16777619u;
+    }
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    return hash;
+  }
+
+
+  /*
+    Looks up an X11 color name, ignoring case like the server does.
+    Returns false if the name is not in the table.
+  */
+  bool findColorName(const std::string &name, int &r, int &g, int &b) {
+    const unsigned int buckets =
+      sizeof(displacements) / sizeof(displacements[0]);
+    const unsigned int slots = sizeof(color_names) / sizeof(color_names[0]);
+
+    const unsigned int bucket = colorNameHash(name, 0) % buckets;
+    const ColorName &entry =
+      color_names[colorNameHash(name, displacements[bucket]) % slots];
+
+    // compare ignoring case, the table is lower case
+    std::string::size_type i = 0;
+    for (; i < name.length() && entry.name[i] != '\0'; ++i) {
+      unsigned char c = name[i];
+      if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+      if (c != static_cast<unsigned char>(entry.name[i]))
+        return false;
+    }
+    if (i != name.length() || entry.name[i] != '\0')
+      return false;
+
+    r = entry.red;
+    g = entry.green;
+    b = entry.blue;
+    return true;
+  }
+
+} // namespace bt
@@ -47,19 +47,22 @@ namespace bt {
   void destroyFontCache(void);
 
 
-  void createPenLoader(const Display &display);
-  void destroyPenLoader(void);
+  void createPenCache(const Display &display);
+  void destroyPenCache(void);
 
 
   void createPixmapCache(const Display &display);
   void destroyPixmapCache(void);
 
 
+  void createColorTables(const Display &display);
   void destroyColorTables(void);
+  void selectRenderKernels(void);
 
 
 #ifdef    MITSHM
   void startupShm(const Display &display);
+  void shutdownShm(const Display &display);
 #endif // MITSHM
 
 } // namespace bt
@@ -94,8 +97,10 @@ bt::Display::Display(const char *dpy_name, bool multi_head) {
   createBitmapLoader(*this);
   createColorCache(*this);
   createFontCache(*this);
-  createPenLoader(*this);
+  createPenCache(*this);
   createPixmapCache(*this);
+  selectRenderKernels();
+  createColorTables(*this);
 
 #ifdef    MITSHM
   startupShm(*this);
@@ -104,9 +109,13 @@ bt::Display::Display(const char *dpy_name, bool multi_head) {
 
 
 bt::Display::~Display() {
+#ifdef    MITSHM
+  shutdownShm(*this);
+#endif // MITSHM
+
   destroyColorTables();
   destroyPixmapCache();
-  destroyPenLoader();
+  destroyPenCache();
   destroyFontCache();
   destroyColorCache();
   destroyBitmapLoader();
@@ -428,7 +428,8 @@ void bt::EWMH::setWMName(Window target, const bt::ustring &name) const {
 }
 
 
-bool bt::EWMH::readWMName(Window target, bt::ustring &name) const {
+bool bt::EWMH::readWMName(Window target,
+                           bt::InternedString &name) const {
   if (!hasUnicode())
     return false; // cannot convert UTF-8 to UTF-32
 
@@ -436,7 +437,8 @@ bool bt::EWMH::readWMName(Window target, bt::ustring &name) const {
   unsigned long nitems;
   if (getListProperty(target, utf8_string, net_wm_name,
                       &data, &nitems) && nitems > 0) {
-    name = toUtf32(reinterpret_cast<char*>(data));
+    // kept as UTF-8, no need to convert
+    name = InternedString::fromUtf8(reinterpret_cast<char*>(data));
     XFree(data);
   }
 
@@ -445,11 +447,11 @@ bool bt::EWMH::readWMName(Window target, bt::ustring &name) const {
 
 
 void bt::EWMH::setWMVisibleName(Window target,
-                                 const bt::ustring &name) const {
+                                 const bt::InternedString &name) const {
   if (!hasUnicode())
     return; // cannot convert UTF-32 to UTF-8
 
-  const std::string utf8 = toUtf8(name);
+  const std::string &utf8 = name.utf8();
   XChangeProperty(display.XDisplay(), target, net_wm_visible_name, utf8_string,
                   8, PropModeReplace,
                   reinterpret_cast<const unsigned char *>(utf8.c_str()),
@@ -457,7 +459,8 @@ void bt::EWMH::setWMVisibleName(Window target,
 }
 
 
-bool bt::EWMH::readWMIconName(Window target, bt::ustring &name) const {
+bool bt::EWMH::readWMIconName(Window target,
+                               bt::InternedString &name) const {
   if (!hasUnicode())
     return false; // cannot convert UTF-8 to UTF-32
 
@@ -465,7 +468,8 @@ bool bt::EWMH::readWMIconName(Window target, bt::ustring &name) const {
   unsigned long nitems;
   if (getListProperty(target, utf8_string, net_wm_icon_name,
                       &data, &nitems) && nitems > 0) {
-    name = toUtf32(reinterpret_cast<char*>(data));
+    // kept as UTF-8, no need to convert
+    name = InternedString::fromUtf8(reinterpret_cast<char*>(data));
     XFree(data);
   }
 
@@ -474,11 +478,11 @@ bool bt::EWMH::readWMIconName(Window target, bt::ustring &name) const {
 
 
 void bt::EWMH::setWMVisibleIconName(Window target,
-                                     const bt::ustring &name) const {
+                                     const bt::InternedString &name) const {
   if (!hasUnicode())
     return; // cannot convert UTF-32 to UTF-8
 
-  const std::string utf8 = toUtf8(name);
+  const std::string &utf8 = name.utf8();
   XChangeProperty(display.XDisplay(), target, net_wm_visible_icon_name, utf8_string,
                   8, PropModeReplace,
                   reinterpret_cast<const unsigned char *>(utf8.c_str()),
@@ -286,10 +286,12 @@ namespace bt {
     { return net_wm_window_opacity; }
 
     void setWMName(Window target, const bt::ustring &name) const;
-    bool readWMName(Window target, bt::ustring &name) const;
-    void setWMVisibleName(Window target, const bt::ustring &name) const;
-    bool readWMIconName(Window target, bt::ustring &name) const;
-    void setWMVisibleIconName(Window target, const bt::ustring &name) const;
+    bool readWMName(Window target, bt::InternedString &name) const;
+    void setWMVisibleName(Window target,
+                          const bt::InternedString &name) const;
+    bool readWMIconName(Window target, bt::InternedString &name) const;
+    void setWMVisibleIconName(Window target,
+                              const bt::InternedString &name) const;
     void setWMDesktop(Window target, unsigned int desktop) const;
     bool readWMDesktop(Window target, unsigned int& desktop) const;
     bool readWMWindowType(Window target, AtomList& types) const;
@@ -28,7 +28,10 @@
 #include "Display.hh"
 #include "Pen.hh"
 #include "Resource.hh"
+#include "XDG.hh"
 
+#include <algorithm>
+#include <list>
 #include <map>
 #include <vector>
 
@@ -41,6 +44,7 @@
 #include <cctype>
 #include <locale.h>
 #include <cstdio>
+#include <unistd.h>
 
 // #define FONTCACHE_DEBUG
 
@@ -72,6 +76,26 @@ namespace bt {
     bool xft_initialized;
 #endif
 
+    /*
+      How font names were resolved on earlier runs, so that the
+      probing round trips are not repeated: "xft" records whether a
+      name is loaded with Xft (1) or as a core font (0), "set" the
+      fontset pattern that loaded without missing charsets, or the
+      widened one.  Kept in the XDG cache directory and keyed by the
+      server vendor and release and the locale as well as the name.
+    */
+    bool findResolution(const char *kind, const std::string &name,
+                        std::string &value);
+    void saveResolution(const char *kind, const std::string &name,
+                        const std::string &value);
+    std::string resolutionKey(const char *kind, const std::string &name);
+    void loadResolutions(void);
+
+    typedef std::map<std::string, std::string> Resolutions;
+    Resolutions resolutions;
+    bool resolutions_loaded;
+    std::string resolutions_file;
+
     struct FontName {
       const std::string name;
       unsigned int screen;
@@ -172,8 +196,238 @@ namespace bt {
 
 
 
+namespace bt {
+
+  struct AdvanceKey {
+    unsigned int screen;
+    std::string fontname;
+    ustring text;
+
+    inline bool operator<(const AdvanceKey &other) const {
+      if (screen != other.screen)
+        return screen < other.screen;
+      if (fontname != other.fontname)
+        return fontname < other.fontname;
+      return text < other.text;
+    }
+  };
+
+  /*
+    Glyph advances of recently ellided strings, as prefix sums: entry
+    i is the advance of the first i characters.  Empty if the advances
+    are not known.
+  */
+  typedef std::map<AdvanceKey, std::vector<int> > AdvanceCache;
+  static AdvanceCache advancecache;
+  static const AdvanceCache::size_type advancecache_limit = 64;
+
+
+  static void textAdvances(unsigned int screen, const Font &font,
+                           const ustring &text, std::vector<int> &prefix) {
+#ifdef XFT
+    XftFont * const f = font.xftFont(screen);
+    if (f) {
+      ::Display * const dpy = fontcache->_display.XDisplay();
+      prefix.resize(text.length() + 1);
+      prefix[0] = 0;
+      for (ustring::size_type i = 0; i < text.length(); ++i) {
+        const FT_UInt glyph = XftCharIndex(dpy, f, text[i]);
+        XGlyphInfo xgi;
+        XftGlyphExtents(dpy, f, &glyph, 1, &xgi);
+        prefix[i + 1] = prefix[i] + xgi.xOff;
+      }
+      return;
+    }
+#else
+    (void) screen;
+#endif
+
+    const std::string str = toLocale(text);
+    std::vector<XRectangle> ink(str.length() + 1), logical(str.length() + 1);
+    XRectangle overall_ink, overall_logical;
+    int count = 0;
+    if (!XmbTextPerCharExtents(font.fontSet(), str.c_str(), str.length(),
+                               &ink[0], &logical[0], ink.size(), &count,
+                               &overall_ink, &overall_logical)
+        || static_cast<ustring::size_type>(count) != text.length()) {
+      // characters do not map one to one in this locale
+      prefix.clear();
+      return;
+    }
+    prefix.resize(text.length() + 1);
+    prefix[0] = 0;
+    for (int i = 0; i < count; ++i)
+      prefix[i + 1] = prefix[i] + logical[i].width;
+  }
+
+
+  static const std::vector<int> &cachedAdvances(unsigned int screen,
+                                                const Font &font,
+                                                const ustring &text) {
+    AdvanceKey key;
+    key.screen = screen;
+    key.fontname = font.fontName();
+    key.text = text;
+
+    AdvanceCache::iterator it = advancecache.find(key);
+    if (it != advancecache.end())
+      return it->second;
+
+    if (advancecache.size() >= advancecache_limit)
+      advancecache.clear();
+    std::vector<int> &prefix = advancecache[key];
+    textAdvances(screen, font, text, prefix);
+    return prefix;
+  }
+
+} // namespace bt
+
+
+namespace bt {
+
+  /*
+    Extents of recently measured strings, most recently used first.
+    Indexed by a hash of the font and the text; the entries keep both
+    to rule out collisions.  UTF-32 and UTF-8 text are kept apart,
+    the latter being measured from interned strings.
+  */
+  class ExtentCache {
+  public:
+    enum { Limit = 1024 };
+
+    inline ExtentCache(void)
+      : hits(0ul), misses(0ul)
+    { }
+
+    inline bool find(const void *font, const ustring &text, Rect &rect)
+    { return find(font, false, bytes(text), bytes(text) + size(text), rect); }
+    inline bool find(const void *font, const std::string &utf8, Rect &rect)
+    { return find(font, true, utf8.data(), utf8.data() + utf8.size(), rect); }
+
+    inline void insert(const void *font, const ustring &text,
+                       const Rect &rect)
+    { insert(font, false, bytes(text), bytes(text) + size(text), rect); }
+    inline void insert(const void *font, const std::string &utf8,
+                       const Rect &rect)
+    { insert(font, true, utf8.data(), utf8.data() + utf8.size(), rect); }
+
+    void clear(void);
+
+    Font::Statistics statistics(void) const;
+
+  private:
+    struct Entry {
+      unsigned long long hash;
+      const void *font;
+      bool utf8;
+      std::string text;
+      Rect rect;
+    };
+    typedef std::list<Entry> EntryList;
+    typedef std::map<unsigned long long, EntryList::iterator> EntryMap;
+
+    static inline const char *bytes(const ustring &text)
+    { return reinterpret_cast<const char *>(text.data()); }
+    static inline size_t size(const ustring &text)
+    { return text.length() * sizeof(ustring::value_type); }
+
+    static unsigned long long hash(const void *font, bool utf8,
+                                   const char *begin, const char *end);
+
+    bool find(const void *font, bool utf8,
+              const char *begin, const char *end, Rect &rect);
+    void insert(const void *font, bool utf8,
+                const char *begin, const char *end, const Rect &rect);
+
+    EntryList entries;
+    EntryMap index;
+    unsigned long hits, misses;
+  };
+
+  static ExtentCache extentcache;
+
+} // namespace bt
+
+
+unsigned long long bt::ExtentCache::hash(const void *font, bool utf8,
+                                         const char *begin,
+                                         const char *end) {
+  // FNV-1a over the font handle, the encoding and the bytes
+  unsigned long long h = 14695981039346656037ull;
+  h ^= reinterpret_cast<unsigned long>(font);
+  h *= 1099511628211ull;
+  h ^= utf8;
+  h *= 1099511628211ull;
+  for (; begin != end; ++begin) {
+    h ^= static_cast<unsigned char>(*begin);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+
+bool bt::ExtentCache::find(const void *font, bool utf8,
+                           const char *begin, const char *end,
+                           Rect &rect) {
+  EntryMap::iterator it = index.find(hash(font, utf8, begin, end));
+  if (it == index.end()
+      || it->second->font != font || it->second->utf8 != utf8
+      || it->second->text.compare(0, std::string::npos,
+                                  begin, end - begin) != 0) {
+    ++misses;
+    return false;
+  }
+
+  // move to the front
+  entries.splice(entries.begin(), entries, it->second);
+  rect = it->second->rect;
+  ++hits;
+  return true;
+}
+
+
+void bt::ExtentCache::insert(const void *font, bool utf8,
+                             const char *begin, const char *end,
+                             const Rect &rect) {
+  const unsigned long long h = hash(font, utf8, begin, end);
+  EntryMap::iterator it = index.find(h);
+  if (it != index.end()) {
+    // collision, the newer string wins
+    entries.erase(it->second);
+    index.erase(it);
+  } else if (entries.size() >= Limit) {
+    index.erase(entries.back().hash);
+    entries.pop_back();
+  }
+
+  Entry entry;
+  entry.hash = h;
+  entry.font = font;
+  entry.utf8 = utf8;
+  entry.text.assign(begin, end);
+  entry.rect = rect;
+  entries.push_front(entry);
+  index.insert(EntryMap::value_type(h, entries.begin()));
+}
+
+
+void bt::ExtentCache::clear(void) {
+  entries.clear();
+  index.clear();
+}
+
+
+bt::Font::Statistics bt::ExtentCache::statistics(void) const {
+  Font::Statistics stats;
+  stats.hits = hits;
+  stats.misses = misses;
+  stats.entries = index.size();
+  return stats;
+}
+
+
 bt::FontCache::FontCache(const Display &dpy)
-  : _display(dpy)
+  : _display(dpy), resolutions_loaded(false)
 {
 #ifdef XFT
   xft_initialized = XftInit(NULL) && XftInitFtLibrary();
@@ -185,6 +439,97 @@ bt::FontCache::~FontCache(void)
 { clear(true); }
 
 
+std::string bt::FontCache::resolutionKey(const char *kind,
+                                         const std::string &name) {
+  char release[32];
+  sprintf(release, "%d", VendorRelease(_display.XDisplay()));
+  const char * const locale = setlocale(LC_CTYPE, 0);
+  std::string key = kind;
+  key += '\t';
+  key += ServerVendor(_display.XDisplay());
+  key += '\t';
+  key += release;
+  key += '\t';
+  key += locale ? locale : "C";
+  key += '\t';
+  key += name;
+  return key;
+}
+
+
+void bt::FontCache::loadResolutions(void) {
+  resolutions_loaded = true;
+  resolutions_file = XDG::BaseDir::writeCacheFile("blackbox/fonts");
+  if (resolutions_file.empty())
+    return;
+
+  FILE *file = fopen(resolutions_file.c_str(), "r");
+  if (!file)
+    return;
+
+  // one "kind vendor release locale name value" line per font, tab separated
+  std::string line;
+  char buf[1024];
+  while (fgets(buf, sizeof(buf), file)) {
+    line += buf;
+    if (line.empty() || line[line.length() - 1] != '\n')
+      continue; // longer than the buffer
+    line.erase(line.length() - 1);
+    const std::string::size_type tab = line.rfind('\t');
+    if (tab != std::string::npos)
+      resolutions[line.substr(0, tab)] = line.substr(tab + 1);
+    line.erase();
+  }
+  fclose(file);
+}
+
+
+bool bt::FontCache::findResolution(const char *kind,
+                                   const std::string &name,
+                                   std::string &value) {
+  if (!resolutions_loaded)
+    loadResolutions();
+
+  Resolutions::const_iterator it = resolutions.find(resolutionKey(kind, name));
+  if (it == resolutions.end())
+    return false;
+  value = it->second;
+  return true;
+}
+
+
+void bt::FontCache::saveResolution(const char *kind,
+                                   const std::string &name,
+                                   const std::string &value) {
+  if (!resolutions_loaded)
+    loadResolutions();
+  if (name.find_first_of("\t\n") != std::string::npos
+      || value.find_first_of("\t\n") != std::string::npos)
+    return; // can't be stored
+
+  std::string &entry = resolutions[resolutionKey(kind, name)];
+  if (entry == value)
+    return;
+  entry = value;
+  if (resolutions_file.empty())
+    return;
+
+  // write a new file and move it into place
+  char suffix[32];
+  sprintf(suffix, ".%ld", static_cast<long>(getpid()));
+  const std::string tmp = resolutions_file + suffix;
+  FILE *file = fopen(tmp.c_str(), "w");
+  if (!file)
+    return;
+  bool ok = true;
+  Resolutions::const_iterator it = resolutions.begin();
+  for (; it != resolutions.end() && ok; ++it)
+    ok = fprintf(file, "%s\t%s\n", it->first.c_str(), it->second.c_str()) > 0;
+  if (fclose(file) != 0 || !ok || rename(tmp.c_str(), resolutions_file.c_str()) != 0)
+    unlink(tmp.c_str());
+}
+
+
 XFontSet bt::FontCache::findFontSet(const std::string &fontsetname) {
   if (fontsetname.empty())
     return findFontSet(defaultFont);
@@ -204,13 +549,19 @@ XFontSet bt::FontCache::findFontSet(const std::string &fontsetname) {
     return it->second.fontset;
   }
 
-  XFontSet fs;
+  XFontSet fs = 0;
   char **missing, *def = const_cast<char *>("-");
   int nmissing;
 
+  // a name that needed widening before will need it again
+  std::string resolved;
+  const bool widen =
+    findResolution("set", fontsetname, resolved) && resolved != fontsetname;
+
   // load the fontset
-  fs = XCreateFontSet(_display.XDisplay(), fontsetname.c_str(),
-                      &missing, &nmissing, &def);
+  if (!widen)
+    fs = XCreateFontSet(_display.XDisplay(), fontsetname.c_str(),
+                        &missing, &nmissing, &def);
   if (fs) {
     if (nmissing) {
       // missing characters, unload and try again below
@@ -226,6 +577,7 @@ XFontSet bt::FontCache::findFontSet(const std::string &fontsetname) {
       fprintf(stderr, gettext("bt::FontCache: add set  '%s'\n"), fontsetname.c_str());
 #endif // FONTCACHE_DEBUG
 
+      saveResolution("set", fontsetname, fontsetname);
       cache.insert(CacheItem(fn, FontRef(fs)));
       return fs; // created fontset
     }
@@ -235,19 +587,24 @@ XFontSet bt::FontCache::findFontSet(const std::string &fontsetname) {
     fontset is missing some charsets, adjust the fontlist to allow
     Xlib to automatically find the needed fonts.
   */
-  xlfd_vector vec = parse_xlfd(fontsetname);
-  std::string newname = fontsetname;
-  if (!vec.empty()) {
-    newname +=
-      ",-*-*-" + vec[xp_weight] + "-" + vec[xp_slant] + "-*-*-" +
-      vec[xp_pixels] + "-*-*-*-*-*-*-*,-*-*-*-*-*-*-" + vec[xp_pixels] +
-      "-" + vec[xp_points] + "-*-*-*-*-*-*,*";
-  } else {
-    newname += "-*-*-*-*-*-*-*-*-*-*-*-*-*-*,*";
+  std::string newname = resolved;
+  if (!widen) {
+    xlfd_vector vec = parse_xlfd(fontsetname);
+    newname = fontsetname;
+    if (!vec.empty()) {
+      newname +=
+        ",-*-*-" + vec[xp_weight] + "-" + vec[xp_slant] + "-*-*-" +
+        vec[xp_pixels] + "-*-*-*-*-*-*-*,-*-*-*-*-*-*-" + vec[xp_pixels] +
+        "-" + vec[xp_points] + "-*-*-*-*-*-*,*";
+    } else {
+      newname += "-*-*-*-*-*-*-*-*-*-*-*-*-*-*,*";
+    }
   }
 
   fs = XCreateFontSet(_display.XDisplay(), newname.c_str(),
                       &missing, &nmissing, &def);
+  if (fs)
+    saveResolution("set", fontsetname, newname);
   if (nmissing) {
     for (int x = 0; x < nmissing; ++x)
       fprintf(stderr, gettext("Warning: missing charset '%s' in fontset\n"),
@@ -293,19 +650,26 @@ XftFont *bt::FontCache::findXftFont(const std::string &fontname,
 
   XftFont *ret = 0;
   bool use_xft = true;
-  int unused = 0;
-  char **list =
-    XListFonts(_display.XDisplay(), fontname.c_str(), 1, &unused);
-  if (list != NULL) {
-    // if fontname is a valid XLFD or alias, use a fontset instead of Xft
-    use_xft = false;
-    XFreeFontNames(list);
+  std::string resolved;
+  if (findResolution("xft", fontname, resolved)) {
+    use_xft = (resolved == "1");
+  } else {
+    int unused = 0;
+    char **list =
+      XListFonts(_display.XDisplay(), fontname.c_str(), 1, &unused);
+    if (list != NULL) {
+      // if fontname is a valid XLFD or alias, use a fontset instead of Xft
+      use_xft = false;
+      XFreeFontNames(list);
+    }
+    saveResolution("xft", fontname, use_xft ? "1" : "0");
+  }
 
 #ifdef FONTCACHE_DEBUG
+  if (!use_xft)
     fprintf(stderr, gettext("bt::FontCache: skp Xft%u '%s'\n"),
             screen, fontname.c_str());
 #endif // FONTCACHE_DEBUG
-  }
 
   if (use_xft) {
     // Xft can't do antialiasing on 8bpp very well
@@ -386,6 +750,9 @@ void bt::FontCache::clear(bool force) {
 
     Cache::iterator r = it++;
     cache.erase(r);
+
+    // a new font could get the same handle
+    extentcache.clear();
   }
 
 #ifdef FONTCACHE_DEBUG
@@ -433,83 +800,135 @@ void bt::Font::unload(void) {
   _xftfont = 0;
   _screen = ~0u;
 #endif
-}
 
+  _metrics.screen = ~0u;
+}
 
-void bt::Font::clearCache(void)
-{ fontcache->clear(false); }
 
+const bt::Font::Metrics &bt::Font::metrics(unsigned int screen) const {
+  if (_metrics.screen == screen)
+    return _metrics;
 
-unsigned int bt::textHeight(unsigned int screen, const Font &font) {
+  _metrics.screen = screen;
 #ifdef XFT
-  const XftFont * const f = font.xftFont(screen);
-  if (f)
-    return f->ascent + f->descent;
+  const XftFont * const f = xftFont(screen);
+  if (f) {
+    _metrics.height = f->ascent + f->descent;
+    _metrics.indent = f->descent;
+    _metrics.ascent = f->ascent;
+    return _metrics;
+  }
 #endif
 
-  return XExtentsOfFontSet(font.fontSet())->max_ink_extent.height;
+  const XFontSetExtents * const e = XExtentsOfFontSet(fontSet());
+  _metrics.height = e->max_ink_extent.height;
+  _metrics.indent = e->max_ink_extent.height + e->max_ink_extent.y;
+  _metrics.ascent = -e->max_ink_extent.y;
+  return _metrics;
 }
 
 
-unsigned int bt::textIndent(unsigned int screen, const Font &font) {
-#ifdef XFT
-  const XftFont * const f = font.xftFont(screen);
-  if (f)
-    return f->descent;
-#endif
-
-  XFontSetExtents *e = XExtentsOfFontSet(font.fontSet());
-  return e->max_ink_extent.height + e->max_ink_extent.y;
+void bt::Font::clearCache(void)
+{
+  fontcache->clear(false);
+  advancecache.clear();
 }
 
 
+bt::Font::Statistics bt::Font::statistics(void)
+{ return extentcache.statistics(); }
+
+
+unsigned int bt::textHeight(unsigned int screen, const Font &font)
+{ return font.metrics(screen).height; }
+
+
+unsigned int bt::textIndent(unsigned int screen, const Font &font)
+{ return font.metrics(screen).indent; }
+
+
 bt::Rect bt::textRect(unsigned int screen, const Font &font,
                       const bt::ustring &text) {
-  const unsigned int indent = textIndent(screen, font);
+  const Font::Metrics &metrics = font.metrics(screen);
 
 #ifdef XFT
   XftFont * const f = font.xftFont(screen);
   if (f) {
+    Rect rect;
+    if (extentcache.find(f, text, rect))
+      return rect;
+
     XGlyphInfo xgi;
     XftTextExtents32(fontcache->_display.XDisplay(), f,
                      reinterpret_cast<const FcChar32 *>(text.data()),
                      text.length(), &xgi);
-    return Rect(xgi.x, 0, xgi.width - xgi.x + (indent * 2),
-                f->ascent + f->descent);
+    rect = Rect(xgi.x, 0, xgi.width - xgi.x + (metrics.indent * 2),
+                metrics.height);
+    extentcache.insert(f, text, rect);
+    return rect;
   }
 #endif
 
+  const XFontSet fs = font.fontSet();
+  Rect rect;
+  if (extentcache.find(fs, text, rect))
+    return rect;
+
   const std::string str = toLocale(text);
   XRectangle ink, unused;
-  XmbTextExtents(font.fontSet(), str.c_str(), str.length(), &ink, &unused);
-  return Rect(ink.x, 0, ink.width - ink.x + (indent * 2),
-              XExtentsOfFontSet(font.fontSet())->max_ink_extent.height);
+  XmbTextExtents(fs, str.c_str(), str.length(), &ink, &unused);
+  rect = Rect(ink.x, 0, ink.width - ink.x + (metrics.indent * 2),
+              metrics.height);
+  extentcache.insert(fs, text, rect);
+  return rect;
 }
 
 
-void bt::drawText(const Font &font, const Pen &pen,
-                  Drawable drawable, const Rect &rect,
-                  Alignment alignment, const bt::ustring &text) {
-  Rect tr = textRect(pen.screen(), font, text);
-  unsigned int indent = textIndent(pen.screen(), font);
+namespace bt {
 
-  // align vertically (center for now)
-  tr.setY(rect.y() + ((rect.height() - tr.height()) / 2));
+  // places the text rect tr inside rect
+  static void alignText(Rect &tr, const Rect &rect, Alignment alignment) {
+    // align vertically (center for now)
+    tr.setY(rect.y() + ((rect.height() - tr.height()) / 2));
 
-  // align horizontally
-  switch (alignment) {
-  case AlignRight:
-    tr.setX(rect.x() + rect.width() - tr.width() - 1);
-    break;
+    // align horizontally
+    switch (alignment) {
+    case AlignRight:
+      tr.setX(rect.x() + rect.width() - tr.width() - 1);
+      break;
 
-  case AlignCenter:
-    tr.setX(rect.x() + (rect.width() - tr.width()) / 2);
-    break;
+    case AlignCenter:
+      tr.setX(rect.x() + (rect.width() - tr.width()) / 2);
+      break;
 
-  default:
-  case AlignLeft:
-    tr.setX(rect.x());
+    default:
+    case AlignLeft:
+      tr.setX(rect.x());
+    }
+  }
+
+#ifdef XFT
+  static XftColor xftColor(const Pen &pen) {
+    XftColor col;
+    col.color.red   = pen.color().red()   | pen.color().red()   << 8;
+    col.color.green = pen.color().green() | pen.color().green() << 8;
+    col.color.blue  = pen.color().blue()  | pen.color().blue()  << 8;
+    col.color.alpha = 0xffff;
+    col.pixel = pen.color().pixel(pen.screen());
+    return col;
   }
+#endif
+
+} // namespace bt
+
+
+void bt::drawText(const Font &font, const Pen &pen,
+                  Drawable drawable, const Rect &rect,
+                  Alignment alignment, const bt::ustring &text) {
+  Rect tr = textRect(pen.screen(), font, text);
+  const Font::Metrics &metrics = font.metrics(pen.screen());
+  unsigned int indent = metrics.indent;
+  alignText(tr, rect, alignment);
 
 #if 0
   // draws the rect 'tr' in red... useful for debugging text placement
@@ -521,15 +940,9 @@ void bt::drawText(const Font &font, const Pen &pen,
 #ifdef XFT
   XftFont * const f = font.xftFont(pen.screen());
   if (f) {
-    XftColor col;
-    col.color.red   = pen.color().red()   | pen.color().red()   << 8;
-    col.color.green = pen.color().green() | pen.color().green() << 8;
-    col.color.blue  = pen.color().blue()  | pen.color().blue()  << 8;
-    col.color.alpha = 0xffff;
-    col.pixel = pen.color().pixel(pen.screen());
-
+    const XftColor col = xftColor(pen);
     XftDrawString32(pen.xftDraw(drawable), &col, f,
-                    tr.x() + indent, tr.y() + f->ascent,
+                    tr.x() + indent, tr.y() + metrics.ascent,
                     reinterpret_cast<const FcChar32 *>(text.data()),
                     text.length());
     return;
@@ -538,12 +951,63 @@ void bt::drawText(const Font &font, const Pen &pen,
 
   const std::string str = toLocale(text);
   XmbDrawString(pen.XDisplay(), drawable, font.fontSet(), pen.gc(),
-                tr.x() + indent,
-                tr.y() - XExtentsOfFontSet(font.fontSet())->max_ink_extent.y,
+                tr.x() + indent, tr.y() + metrics.ascent,
                 str.c_str(), str.length());
 }
 
 
+bt::Rect bt::textRect(unsigned int screen, const Font &font,
+                      const bt::InternedString &text) {
+#ifdef XFT
+  XftFont * const f = font.xftFont(screen);
+  if (f) {
+    // measure the UTF-8 directly
+    const std::string &utf8 = text.utf8();
+    Rect rect;
+    if (extentcache.find(f, utf8, rect))
+      return rect;
+
+    const Font::Metrics &metrics = font.metrics(screen);
+    XGlyphInfo xgi;
+    XftTextExtentsUtf8(fontcache->_display.XDisplay(), f,
+                       reinterpret_cast<const FcChar8 *>(utf8.data()),
+                       utf8.length(), &xgi);
+    rect = Rect(xgi.x, 0, xgi.width - xgi.x + (metrics.indent * 2),
+                metrics.height);
+    extentcache.insert(f, utf8, rect);
+    return rect;
+  }
+#endif
+
+  // font sets want the locale encoding
+  return textRect(screen, font, text.unicode());
+}
+
+
+void bt::drawText(const Font &font, const Pen &pen,
+                  Drawable drawable, const Rect &rect,
+                  Alignment alignment, const bt::InternedString &text) {
+#ifdef XFT
+  XftFont * const f = font.xftFont(pen.screen());
+  if (f) {
+    Rect tr = textRect(pen.screen(), font, text);
+    const Font::Metrics &metrics = font.metrics(pen.screen());
+    alignText(tr, rect, alignment);
+
+    const std::string &utf8 = text.utf8();
+    const XftColor col = xftColor(pen);
+    XftDrawStringUtf8(pen.xftDraw(drawable), &col, f,
+                      tr.x() + metrics.indent, tr.y() + metrics.ascent,
+                      reinterpret_cast<const FcChar8 *>(utf8.data()),
+                      utf8.length());
+    return;
+  }
+#endif
+
+  drawText(font, pen, drawable, rect, alignment, text.unicode());
+}
+
+
 bt::ustring bt::ellideText(const bt::ustring &text, size_t count,
                            const bt::ustring &ellide) {
   const bt::ustring::size_type len = text.length();
@@ -564,20 +1028,74 @@ bt::ustring bt::ellideText(const bt::ustring &text,
                            const bt::ustring &ellide,
                            unsigned int screen,
                            const bt::Font &font) {
-  bt::ustring visible = text;
-  bt::Rect r = bt::textRect(screen, font, visible);
-
-  if (r.width() > max_width) {
-    const int min_c = (ellide.length() * 3) - 1;
-    int c = visible.length();
-    while (--c > min_c && r.width() > max_width) {
-      visible = bt::ellideText(text, c, ellide);
-      r = bt::textRect(screen, font, visible);
+  const bt::Rect r = bt::textRect(screen, font, text);
+  if (r.width() <= max_width)
+    return text;
+
+  /*
+    Find the largest count c in (min_c, length) such that
+    ellideText(text, c, ellide) fits.  Wider counts keep more of both
+    ends, so this is a binary search between lo, which fits (min_c
+    stands for the ellipsis alone), and hi, which does not.
+  */
+  const int min_c = ellide.length() * 3;
+  const int len = text.length();
+  int lo = min_c, hi = len;
+  if (hi - lo <= 1)
+    return ellide; // couldn't ellide enough
+
+  /*
+    Guess the count from the glyph advances: the kept head and tail
+    plus the ellipsis, with the same ink and indent overhead as the
+    whole text.  Usually only the guess and its neighbor need to be
+    measured.
+  */
+  int guess = (lo + hi) / 2;
+  const std::vector<int> &prefix = cachedAdvances(screen, font, text);
+  const std::vector<int> &ellipsis = cachedAdvances(screen, font, ellide);
+  if (!prefix.empty() && !ellipsis.empty()) {
+    const int overhead = static_cast<int>(r.width()) - prefix[len];
+    const int e = ellide.length();
+    int l = lo + 1, h = hi - 1;
+    guess = lo;
+    while (l <= h) {
+      const int c = (l + h) / 2;
+      const int head = std::max((c / 2) - (e / 2), 0);
+      const int tail = std::max((c / 2) - (e / 2) - 1, 0);
+      const int width = (prefix[head] + ellipsis[e]
+                         + (prefix[len] - prefix[len - tail]) + overhead);
+      if (width <= static_cast<int>(max_width)) {
+        guess = c;
+        l = c + 1;
+      } else {
+        h = c - 1;
+      }
+    }
+    if (guess == lo)
+      guess = lo + 1;
+  }
+
+  bt::ustring visible;
+  bool first = true;
+  int c = guess;
+  while (hi - lo > 1) {
+    const bt::ustring candidate = bt::ellideText(text, c, ellide);
+    if (bt::textRect(screen, font, candidate).width() <= max_width) {
+      lo = c;
+      visible = candidate;
+      // most likely the guess was right, check the next one up
+      c = first ? c + 1 : (lo + hi) / 2;
+    } else {
+      hi = c;
+      c = first ? c - 1 : (lo + hi) / 2;
     }
-    if (c <= min_c)
-      visible = ellide; // couldn't ellide enough
+    first = false;
+    if (c <= lo || c >= hi)
+      c = (lo + hi) / 2;
   }
 
+  if (lo == min_c)
+    return ellide; // couldn't ellide enough
   return visible;
 }
 
@@ -53,10 +53,19 @@ namespace bt {
 
   Rect textRect(unsigned int screen, const Font &font,
                 const bt::ustring &text);
+  Rect textRect(unsigned int screen, const Font &font,
+                const InternedString &text);
 
   void drawText(const Font &font, const Pen &pen,
                 Drawable drawable, const Rect &rect,
                 Alignment alignment, const ustring &text);
+  /*
+    Xft fonts draw and measure interned strings from their UTF-8
+    directly; font sets convert to the locale encoding as usual.
+  */
+  void drawText(const Font &font, const Pen &pen,
+                Drawable drawable, const Rect &rect,
+                Alignment alignment, const InternedString &text);
 
   /*
    * Take a string and make it 'count' chars long by removing the
@@ -85,9 +94,20 @@ namespace bt {
   public:
     static void clearCache(void);
 
+    /*
+      Lookups in the cache of recently measured strings, which is
+      shared by all fonts.
+    */
+    struct Statistics {
+      unsigned long hits;
+      unsigned long misses;
+      unsigned long entries;
+    };
+    static Statistics statistics(void);
+
     explicit inline Font(const std::string &name = std::string())
       : _fontname(name), _fontset(0), _xftfont(0), _screen(~0u)
-    { }
+    { _metrics.screen = ~0u; }
     inline ~Font(void)
     { unload(); }
 
@@ -109,10 +129,33 @@ namespace bt {
   private:
     void unload(void);
 
+    // the vertical metrics used for every string drawn in the font
+    struct Metrics {
+      unsigned int screen; // ~0u if not known yet
+      unsigned int height;
+      unsigned int indent;
+      int ascent;
+    };
+    const Metrics &metrics(unsigned int screen) const;
+
+    friend unsigned int textHeight(unsigned int screen, const Font &font);
+    friend unsigned int textIndent(unsigned int screen, const Font &font);
+    friend Rect textRect(unsigned int screen, const Font &font,
+                         const bt::ustring &text);
+    friend Rect textRect(unsigned int screen, const Font &font,
+                         const InternedString &text);
+    friend void drawText(const Font &font, const Pen &pen,
+                         Drawable drawable, const Rect &rect,
+                         Alignment alignment, const ustring &text);
+    friend void drawText(const Font &font, const Pen &pen,
+                         Drawable drawable, const Rect &rect,
+                         Alignment alignment, const InternedString &text);
+
     std::string _fontname;
     mutable XFontSet _fontset;
     mutable XftFont *_xftfont;
     mutable unsigned int _screen; // only used for Xft
+    mutable Metrics _metrics;
   };
 
 } // namespace bt
@@ -29,6 +29,8 @@
 #include "Texture.hh"
 
 #include <algorithm>
+#include <list>
+#include <map>
 #include <vector>
 
 #include <X11/Xlib.h>
@@ -41,6 +43,17 @@
 #  include <X11/extensions/XShm.h>
 #endif // MITSHM
 
+#ifdef    HAVE_MMAP
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <dirent.h>
+#  include <fcntl.h>
+#  include <time.h>
+#  include <unistd.h>
+#  include "XDG.hh"
+#endif // HAVE_MMAP
+
 #include <assert.h>
 #include <math.h>
 #include <cstdio>
@@ -48,6 +61,12 @@
 
 #include <cstring>
 
+#if defined(SIMD) && defined(__GNUC__) \
+  && (defined(__i386__) || defined(__x86_64__))
+#  define SIMD_X86
+#  include <immintrin.h>
+#endif // SIMD && __GNUC__ && x86
+
 // #define COLORTABLE_DEBUG
 // #define MITSHM_DEBUG
 
@@ -69,6 +88,20 @@ static int lowest_bit(unsigned int v)
 }
 
 
+/*
+ * Returns the level of an 8 bit channel value for a channel with the
+ * given number of levels.  This matches XColorTable::map(), except for
+ * deep color visuals (more than 8 bits per channel), where the value
+ * is stretched over the full range.
+ */
+static unsigned long channelLevel(unsigned int value, unsigned int levels)
+{
+  if (levels <= 256u)
+    return (value * levels) >> 8;
+  return (value * (levels - 1) + 127) / 255;
+}
+
+
 unsigned int bt::Image::global_maximumColors = 0u; // automatic
 bt::DitherMode bt::Image::global_ditherMode = bt::OrderedDither;
 
@@ -83,37 +116,196 @@ namespace bt {
 
     inline bt::DitherMode ditherMode(void) const
     {
-      return ((n_red < 256u || n_green < 256u || n_blue < 256u)
+      return (!dither_table.empty()
               ? bt::Image::ditherMode()
               : bt::NoDither);
     }
 
-    void map(unsigned int &red,
-             unsigned int &green,
-             unsigned int &blue);
-    unsigned long pixel(unsigned int red,
-                        unsigned int green,
-                        unsigned int blue);
+    /*
+      Ordered dither levels for each channel, indexed by
+      ((y & 15) * 16 + (x & 15)) * 256 + value.  Only valid when
+      ditherMode() != NoDither.
+    */
+    inline const unsigned char *redDither(void) const
+    { return &dither_table[0]; }
+    inline const unsigned char *greenDither(void) const
+    { return &dither_table[65536]; }
+    inline const unsigned char *blueDither(void) const
+    { return &dither_table[131072]; }
+
+    /*
+      The way a mapped rgb is turned into a pixel value: by gray level,
+      by color cube index or by shifting the channels into place.
+    */
+    enum VisualKind { GrayVisual, IndexedVisual, DirectVisual };
+    inline VisualKind visualKind(void) const
+    { return kind; }
+
+    inline void map(unsigned int &red,
+                    unsigned int &green,
+                    unsigned int &blue) const {
+      red   = (red   * n_red)   >> 8;
+      green = (green * n_green) >> 8;
+      blue  = (blue  * n_blue)  >> 8;
+    }
+
+    inline unsigned long grayPixel(unsigned int red,
+                                   unsigned int green,
+                                   unsigned int blue) const
+    { return colors[(red * 30 + green * 59 + blue * 11) / 100]; }
+    inline unsigned long indexedPixel(unsigned int red,
+                                      unsigned int green,
+                                      unsigned int blue) const
+    { return colors[(red * n_green * n_blue) + (green * n_blue) + blue]; }
+    inline unsigned long directPixel(unsigned int red,
+                                     unsigned int green,
+                                     unsigned int blue) const {
+      return ((red << red_shift)
+              | (green << green_shift)
+              | (blue << blue_shift));
+    }
+
+    // direct visuals only: looks up unmapped 8 bit channel values
+    inline unsigned long truePixel(unsigned int red,
+                                   unsigned int green,
+                                   unsigned int blue) const
+    { return red_table[red] | green_table[green] | blue_table[blue]; }
 
   private:
     const Display &_dpy;
     unsigned int _screen;
     int visual_class;
+    VisualKind kind;
     unsigned int n_red, n_green, n_blue;
     int red_shift, green_shift, blue_shift;
 
     std::vector<unsigned long> colors;
+    unsigned long red_table[256], green_table[256], blue_table[256];
+    std::vector<unsigned char> dither_table;
+
+    void createDitherTable(void);
   };
 
 
   typedef std::vector<unsigned char> Buffer;
   static Buffer buffer;
 
+  // Floyd-Steinberg workspace: error lines and the mapped output line
+  static std::vector<short> ditherErrors;
+  static std::vector<RGB> ditherLine;
+
+
+  // number of times a render arena had to allocate memory
+  static unsigned long render_allocations = 0ul;
+
+  /*
+    A buffer that is kept between renders.  It grows by half its size
+    when too small, and is trimmed back to the largest recent request
+    when that needed less than half of it.
+  */
+  template <typename T>
+  class ArenaBlock : public NoCopy {
+  public:
+    ArenaBlock(void) : _data(0), _capacity(0u), _peak(0u) { }
+    ~ArenaBlock(void) { delete [] _data; }
+
+    T *get(unsigned int count) {
+      _peak = std::max(_peak, count);
+      if (count > _capacity)
+        reallocate(std::max(count, _capacity + _capacity / 2));
+      return _data;
+    }
+
+    void trim(void) {
+      if (_capacity > _peak * 2)
+        reallocate(_peak);
+      _peak = 0u;
+    }
+
+  private:
+    void reallocate(unsigned int capacity) {
+      delete [] _data;
+      _data = 0;
+      if (capacity > 0u) {
+        _data = new T[capacity];
+        ++render_allocations;
+      }
+      _capacity = capacity;
+    }
+
+    T *_data;
+    unsigned int _capacity, _peak;
+  };
+
+  /*
+    The render buffers for one screen: the image data and the gradient
+    tables.  The buffers are trimmed when the application goes idle
+    (see Image::trimRenderBuffers()), so a burst of large renders
+    (e.g. resizing a window) does not keep the memory forever.
+  */
+  class RenderArena : public NoCopy {
+  public:
+    RenderArena(void) : renders(0u) { }
+
+    ArenaBlock<RGB> image;
+    ArenaBlock<unsigned int> tables;
+
+    void finishRender(void)
+    { ++renders; }
+
+    void trim(void) {
+      if (renders == 0u)
+        return; // nothing rendered since the last trim
+      image.trim();
+      tables.trim();
+      renders = 0u;
+    }
+
+  private:
+    unsigned int renders;
+  };
+
+  typedef std::vector<RenderArena*> RenderArenaList;
+  static RenderArenaList renderArenaList;
+
 
   typedef std::vector<XColorTable*> XColorTableList;
   static XColorTableList colorTableList;
 
 
+  /*
+    Color tables for direct visuals are created up front, so the first
+    render does not pay for them.  Color tables for the other visuals
+    depend on Image::maximumColors(), which is not known yet, and are
+    created on first use.
+  */
+  void createColorTables(const Display &display) {
+    colorTableList.resize(display.screenCount(), 0);
+
+    for (unsigned int i = 0; i < display.screenCount(); ++i) {
+      const int c_class = display.screenInfo(i).visual()->c_class;
+      if (c_class != TrueColor && c_class != DirectColor)
+        continue;
+      colorTableList[i] =
+        new XColorTable(display, i, Image::maximumColors());
+    }
+  }
+
+
+  // returns the color table for the screen, creating it if necessary
+  static XColorTable *findColorTable(const Display &display,
+                                     unsigned int screen) {
+    if (colorTableList.empty())
+      colorTableList.resize(display.screenCount(), 0);
+
+    if (!colorTableList[screen])
+      colorTableList[screen] =
+        new XColorTable(display, screen, Image::maximumColors());
+
+    return colorTableList[screen];
+  }
+
+
   void destroyColorTables(void) {
     XColorTableList::iterator it = colorTableList.begin(),
                              end = colorTableList.end();
@@ -123,16 +315,37 @@ namespace bt {
       *it = 0;
     }
     colorTableList.clear();
+
+    std::for_each(renderArenaList.begin(), renderArenaList.end(),
+                  PointerAssassin());
+    renderArenaList.clear();
+
     buffer.clear();
+    ditherErrors.clear();
+    ditherLine.clear();
   }
 
 
 #ifdef MITSHM
-  static XShmSegmentInfo shm_info;
+  /*
+    MIT-SHM segments are kept in a small pool and reused for every
+    render.  Uploads ask the X server for a ShmCompletion event, and a
+    segment is not written again until that event has arrived (or a
+    round trip has passed), so there is no round trip per image.
+  */
+  struct ShmSegment {
+    XShmSegmentInfo info;
+    unsigned int size;
+    bool busy;
+  };
+
+  typedef std::vector<ShmSegment*> ShmSegmentList;
+  static ShmSegmentList shm_segments;
+  static const unsigned int max_shm_segments = 3u;
+  static unsigned int shm_largest_request = 0u;
+  static unsigned int shm_requests = 0u;
   static bool use_shm = false;
-  static bool shm_attached = false;
-  static int shm_id = -1;
-  static char *shm_addr = reinterpret_cast<char *>(-1);
+  static int shm_completion_type = -1;
 
 
   static int handleShmError(::Display *, XErrorEvent *) {
@@ -145,111 +358,568 @@ namespace bt {
     // query MIT-SHM extension
     if (!XShmQueryExtension(display.XDisplay()))
       return;
+    shm_completion_type = XShmGetEventBase(display.XDisplay()) + ShmCompletion;
     use_shm = true;
   }
 
 
-  void destroyShmImage(const Display &display, XImage *image) {
-    // tell the X server to detach
-    if (shm_attached) {
-      XShmDetach(display.XDisplay(), &shm_info);
+  void shutdownShm(const Display &display) {
+    if (shm_segments.empty())
+      return;
+
+    ShmSegmentList::iterator it, end = shm_segments.end();
+    for (it = shm_segments.begin(); it != end; ++it)
+      XShmDetach(display.XDisplay(), &(*it)->info);
 
-      // wait for the server to render the image and detach the memory
-      // segment
-      XSync(display.XDisplay(), False);
+    // wait for the server to detach before we do
+    XSync(display.XDisplay(), False);
 
-      shm_attached = false;
+    for (it = shm_segments.begin(); it != end; ++it) {
+      shmdt((*it)->info.shmaddr);
+      delete *it;
     }
+    shm_segments.clear();
+  }
 
-    // detach shared memory segment
-    if (shm_addr != reinterpret_cast<char *>(-1))
-      shmdt(shm_addr);
-    shm_addr = reinterpret_cast<char *>(-1);
 
-    // destroy shared memory id
-    if (shm_id != -1)
-      shmctl(shm_id, IPC_RMID, 0);
-    shm_id = -1;
+  bool processShmEvent(const XEvent *event) {
+    if (event->type != shm_completion_type)
+      return false;
 
-    // destroy XImage
-    image->data = 0;
-    XDestroyImage(image);
+    const XShmCompletionEvent * const completion =
+      reinterpret_cast<const XShmCompletionEvent *>(event);
+    ShmSegmentList::iterator it = shm_segments.begin(),
+                            end = shm_segments.end();
+    for (; it != end; ++it) {
+      if ((*it)->info.shmseg == completion->shmseg)
+        (*it)->busy = false;
+    }
+    return true;
   }
 
 
-  XImage *createShmImage(const Display &display, const ScreenInfo &screeninfo,
-                         unsigned int width, unsigned int height) {
-    if (!use_shm)
-      return 0;
+  static Bool isShmCompletion(::Display *, XEvent *event, XPointer) {
+    return event->type == shm_completion_type;
+  }
 
-    // use MIT-SHM extension
-    XImage *image = XShmCreateImage(display.XDisplay(), screeninfo.visual(),
-                                    screeninfo.depth(), ZPixmap, 0,
-                                    &shm_info, width, height);
-    if (!image)
-      return 0;
+
+  static ShmSegment *createShmSegment(const Display &display,
+                                      unsigned int size) {
+    ShmSegment *segment = new ShmSegment;
+    segment->size = size;
+    segment->busy = false;
 
     // get shared memory id
-    unsigned int usage = image->bytes_per_line * image->height;
-    shm_id = shmget(IPC_PRIVATE, usage, IPC_CREAT | 0644);
-    if (shm_id == -1) {
+    segment->info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0644);
+    if (segment->info.shmid == -1) {
 #ifdef MITSHM_DEBUG
-      perror("bt::createShmImage: shmget");
+      perror("bt::createShmSegment: shmget");
 #endif // MITSHM_DEBUG
 
       use_shm = false;
-      XDestroyImage(image);
+      delete segment;
       return 0;
     }
 
-    // attached shared memory segment
-    shm_addr = static_cast<char *>(shmat(shm_id, 0, 0));
-    if (shm_addr == reinterpret_cast<char *>(-1)) {
+    // attach shared memory segment
+    segment->info.shmaddr = static_cast<char *>(shmat(segment->info.shmid,
+                                                      0, 0));
+    if (segment->info.shmaddr == reinterpret_cast<char *>(-1)) {
 #ifdef MITSHM_DEBUG
-      perror("bt::createShmImage: shmat");
+      perror("bt::createShmSegment: shmat");
 #endif // MITSHM_DEBUG
 
       use_shm = false;
-      destroyShmImage(display, image);
+      shmctl(segment->info.shmid, IPC_RMID, 0);
+      delete segment;
       return 0;
     }
+    segment->info.readOnly = True;
 
-    // tell the X server to attach
-    shm_info.shmid = shm_id;
-    shm_info.shmaddr = shm_addr;
-    shm_info.readOnly = True;
+    // tell the X server to attach, and wait for it so that the segment
+    // can be marked for removal; it then goes away with the last detach,
+    // even if we crash
+    XErrorHandler old_handler = XSetErrorHandler(handleShmError);
+    XShmAttach(display.XDisplay(), &segment->info);
+    XSync(display.XDisplay(), False);
+    XSetErrorHandler(old_handler);
 
-    static bool test_server_attach = true;
-    if (test_server_attach) {
-      // never checked if the X server can do shared memory...
-      XErrorHandler old_handler = XSetErrorHandler(handleShmError);
-      XShmAttach(display.XDisplay(), &shm_info);
-      XSync(display.XDisplay(), False);
-      XSetErrorHandler(old_handler);
+    shmctl(segment->info.shmid, IPC_RMID, 0);
 
-      if (!use_shm) {
-        // the X server failed to attach the shm segment
+    if (!use_shm) {
+      // the X server failed to attach the shm segment
 
 #ifdef MITSHM_DEBUG
-        fprintf(stderr, gettext("bt::createShmImage: X server failed to attach\n"));
+      fprintf(stderr, gettext("bt::createShmSegment: X server failed to attach\n"));
 #endif // MITSHM_DEBUG
 
-        destroyShmImage(display, image);
-        return 0;
+      shmdt(segment->info.shmaddr);
+      delete segment;
+      return 0;
+    }
+
+    return segment;
+  }
+
+
+  /*
+    Returns an idle segment of at least the requested size.  New segments
+    are made as large as the largest of the last 64 requests, so a single
+    segment can hold any of the recent renders.
+  */
+  static ShmSegment *findShmSegment(const Display &display,
+                                    unsigned int size) {
+    if (++shm_requests % 64u == 0u)
+      shm_largest_request = 0u;
+    shm_largest_request = std::max(shm_largest_request, size);
+
+    for (;;) {
+      ShmSegment *best = 0, *smallest = 0;
+      ShmSegmentList::iterator it = shm_segments.begin(),
+                              end = shm_segments.end();
+      for (; it != end; ++it) {
+        ShmSegment * const segment = *it;
+        if (segment->busy)
+          continue;
+        if (segment->size >= size
+            && (!best || segment->size < best->size))
+          best = segment;
+        if (!smallest || segment->size < smallest->size)
+          smallest = segment;
+      }
+      if (best)
+        return best;
+
+      if (smallest && shm_segments.size() == max_shm_segments) {
+        // replace an idle segment that is too small
+        XShmDetach(display.XDisplay(), &smallest->info);
+        shmdt(smallest->info.shmaddr);
+        shm_segments.erase(std::find(shm_segments.begin(),
+                                     shm_segments.end(), smallest));
+        delete smallest;
       }
 
-      test_server_attach = false;
-    } else {
-      // we know the X server can attach to the memory segment
-      XShmAttach(display.XDisplay(), &shm_info);
+      if (shm_segments.size() < max_shm_segments) {
+        ShmSegment * const segment =
+          createShmSegment(display, shm_largest_request);
+        if (segment)
+          shm_segments.push_back(segment);
+        return segment;
+      }
+
+      /*
+        All segments are being uploaded.  An upload that failed never
+        sends its ShmCompletion, so rather than wait for one, make a
+        round trip: the server has then finished every earlier
+        XShmPutImage, and all segments are idle (only renderPixmap()
+        holds an image, and never more than one).
+      */
+      XSync(display.XDisplay(), False);
+      XEvent event;
+      while (XCheckIfEvent(display.XDisplay(), &event, isShmCompletion, 0))
+        ;
+      for (it = shm_segments.begin(); it != end; ++it)
+        (*it)->busy = false;
+    }
+  }
+
+
+  XImage *createShmImage(const Display &display, const ScreenInfo &screeninfo,
+                         unsigned int width, unsigned int height) {
+    if (!use_shm)
+      return 0;
+
+    // use MIT-SHM extension
+    XImage *image = XShmCreateImage(display.XDisplay(), screeninfo.visual(),
+                                    screeninfo.depth(), ZPixmap, 0,
+                                    0, width, height);
+    if (!image)
+      return 0;
+
+    ShmSegment * const segment =
+      findShmSegment(display, image->bytes_per_line * image->height);
+    if (!segment) {
+      XDestroyImage(image);
+      return 0;
     }
 
-    shm_attached = true;
-    image->data = shm_addr;
+    segment->busy = true;
+    image->obdata = reinterpret_cast<char *>(&segment->info);
+    image->data = segment->info.shmaddr;
     return image;
   }
+
+
+  /*
+    Destroys an image returned by createShmImage().  If the image was
+    uploaded with XShmPutImage(), its segment stays busy until the
+    ShmCompletion event for it arrives.
+  */
+  void destroyShmImage(XImage *image, bool uploaded) {
+    if (!uploaded) {
+      ShmSegmentList::iterator it = shm_segments.begin(),
+                              end = shm_segments.end();
+      for (; it != end; ++it) {
+        if (image->obdata == reinterpret_cast<char *>(&(*it)->info))
+          (*it)->busy = false;
+      }
+    }
+
+    image->data = 0;
+    image->obdata = 0;
+    XDestroyImage(image);
+  }
 #endif // MITSHM
 
+
+#ifdef    HAVE_MMAP
+  /*
+   * On-disk render cache
+   *
+   * Large images rendered in software for direct visuals are saved as
+   * finished XImage data, one file per image, and mapped straight into
+   * XPutImage() after a restart.  Pixels on direct visuals only depend
+   * on the visual, so the files stay valid as long as the renderer
+   * does.  The files are removed when render_cache_version or the
+   * stamp passed to Image::setRenderCache() changes.
+   *
+   * The directory is read once when the cache is enabled, and lookups
+   * only open files that are in that index.  New images are copied to
+   * a queue and written by Image::writeRenderCache() while the
+   * application is idle, oldest files first making room when the
+   * directory would grow past render_cache_max_bytes.  While a window
+   * is resized interactively, only the last size rendered for each
+   * texture is kept for writing.
+   */
+
+  // bump when the software renderer output changes
+  static const unsigned int render_cache_version = 1u;
+  // smaller images are cheaper to render than to load
+  static const unsigned int render_cache_min_pixels = 4096u;
+  // the oldest files are removed to keep the directory below this
+  static const unsigned long render_cache_max_bytes = 32ul * 1024ul * 1024ul;
+  // images waiting to be written are dropped beyond this
+  static const unsigned long render_cache_max_queued = 8ul * 1024ul * 1024ul;
+  // ends with a slash, empty when disabled
+  static std::string render_cache_dir;
+  // what the stamp file held when the directory was opened
+  static std::string render_cache_stamp;
+
+  struct RenderCacheHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int width, height;
+    unsigned int depth, bits_per_pixel, byte_order, bytes_per_line;
+    unsigned int dither;
+    unsigned long red_mask, green_mask, blue_mask;
+    unsigned long long fingerprint;
+  };
+
+  struct RenderCacheFile {
+    unsigned long bytes;
+    time_t mtime;
+    unsigned long serial; // orders files written in the same second
+
+    inline bool olderThan(const RenderCacheFile &other) const {
+      return (mtime < other.mtime
+              || (mtime == other.mtime && serial < other.serial));
+    }
+  };
+
+  // the files in render_cache_dir, by name
+  typedef std::map<unsigned long long, RenderCacheFile> RenderCacheIndex;
+  static RenderCacheIndex render_cache_index;
+  static unsigned long render_cache_bytes = 0ul;
+  static unsigned long render_cache_serial = 0ul;
+
+  struct RenderCacheWrite {
+    RenderCacheHeader header;
+    unsigned long long hash;
+    std::vector<char> data;
+    bool interactive; // rendered during an interactive resize
+  };
+
+  typedef std::list<RenderCacheWrite> RenderCacheWriteList;
+  static RenderCacheWriteList render_cache_writes;
+  static unsigned long render_cache_queued = 0ul;
+  static bool interactive_resize = false;
+
+
+  /*
+    Fills in the header describing how the texture would be rendered.
+    Returns false if the image should not be cached.
+  */
+  static bool renderCacheHeader(const Display &display, unsigned int screen,
+                                const Texture &texture,
+                                unsigned int width, unsigned int height,
+                                RenderCacheHeader &header) {
+    if (render_cache_dir.empty() || width * height < render_cache_min_pixels)
+      return false;
+
+    const XColorTable * const colortable = findColorTable(display, screen);
+    if (colortable->visualKind() != XColorTable::DirectVisual)
+      return false; // pixels depend on the colormap
+
+    // let Xlib compute the image layout
+    const ScreenInfo &screeninfo = display.screenInfo(screen);
+    XImage *image = XCreateImage(display.XDisplay(), screeninfo.visual(),
+                                 screeninfo.depth(), ZPixmap,
+                                 0, 0, width, height, 32, 0);
+    if (!image)
+      return false;
+
+    // zero the padding too, the header is compared and hashed as bytes
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "btimage", 8);
+    header.version = render_cache_version;
+    header.width = width;
+    header.height = height;
+    header.depth = image->depth;
+    header.bits_per_pixel = image->bits_per_pixel;
+    header.byte_order = image->byte_order;
+    header.bytes_per_line = image->bytes_per_line;
+    header.dither = colortable->ditherMode();
+    header.red_mask = image->red_mask;
+    header.green_mask = image->green_mask;
+    header.blue_mask = image->blue_mask;
+    header.fingerprint = texture.fingerprint();
+
+    XDestroyImage(image);
+    return true;
+  }
+
+
+  static unsigned long long renderCacheHash(const RenderCacheHeader &header) {
+    // FNV-1a over the header
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&header);
+    unsigned long long hash = 14695981039346656037ull;
+    for (unsigned int i = 0; i < sizeof(header); ++i) {
+      hash ^= p[i];
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+
+  static std::string renderCachePath(unsigned long long hash) {
+    char name[32];
+    sprintf(name, "%016llx", hash);
+    return render_cache_dir + name;
+  }
+
+
+  static void forgetRenderCacheFile(RenderCacheIndex::iterator it) {
+    render_cache_bytes -= it->second.bytes;
+    render_cache_index.erase(it);
+  }
+
+
+  // drops the images waiting to be written
+  static void clearRenderCacheWrites(void) {
+    render_cache_writes.clear();
+    render_cache_queued = 0ul;
+  }
+
+
+  // reads the names, sizes and times of the files in the directory
+  static void loadRenderCacheIndex(const std::string &dir) {
+    render_cache_index.clear();
+    render_cache_bytes = 0ul;
+
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+      return;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != 0) {
+      // cache files are named by their hash, skip the stamp and
+      // files still being written
+      const char * const name = entry->d_name;
+      if (strlen(name) != 16 || strspn(name, "0123456789abcdef") != 16)
+        continue;
+
+      struct stat st;
+      if (stat((dir + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        continue;
+
+      RenderCacheFile file;
+      file.bytes = st.st_size;
+      file.mtime = st.st_mtime;
+      file.serial = 0ul;
+      render_cache_index[strtoull(name, 0, 16)] = file;
+      render_cache_bytes += file.bytes;
+    }
+    closedir(d);
+  }
+
+
+  /*
+    Uploads the cached image described by header to a new pixmap.
+    Returns None if it is not cached.
+  */
+  static Pixmap loadRenderCache(const Display &display, unsigned int screen,
+                                const RenderCacheHeader &header) {
+    const unsigned long long hash = renderCacheHash(header);
+    const RenderCacheIndex::iterator it = render_cache_index.find(hash);
+    if (it == render_cache_index.end())
+      return None;
+
+    const std::string path = renderCachePath(hash);
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      forgetRenderCacheFile(it); // removed by another instance
+      return None;
+    }
+
+    const size_t length =
+      sizeof(header) + header.bytes_per_line * header.height;
+    void *map = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == length)
+      map = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+      return None;
+
+    Pixmap pixmap = None;
+    if (memcmp(map, &header, sizeof(header)) == 0) {
+      const ScreenInfo &screeninfo = display.screenInfo(screen);
+      char *data = static_cast<char *>(map) + sizeof(header);
+      XImage *image = XCreateImage(display.XDisplay(), screeninfo.visual(),
+                                   screeninfo.depth(), ZPixmap, 0, data,
+                                   header.width, header.height, 32,
+                                   header.bytes_per_line);
+      if (image)
+        pixmap = XCreatePixmap(display.XDisplay(), screeninfo.rootWindow(),
+                               header.width, header.height,
+                               screeninfo.depth());
+      if (pixmap) {
+        // XPutImage() is done with the data when it returns
+        Pen pen(screen, Color(0, 0, 0));
+        XPutImage(pen.XDisplay(), pixmap, pen.gc(), image,
+                  0, 0, 0, 0, header.width, header.height);
+      }
+      if (image) {
+        image->data = 0;
+        XDestroyImage(image);
+      }
+    }
+
+    munmap(map, length);
+    return pixmap;
+  }
+
+
+  /*
+    Copies a rendered image to the write queue.  During an interactive
+    resize, it replaces the queued image of the same texture, so only
+    the last size is written.
+  */
+  static void queueRenderCache(const RenderCacheHeader &header,
+                               const char *data) {
+    const unsigned long long hash = renderCacheHash(header);
+    if (render_cache_index.find(hash) != render_cache_index.end())
+      return;
+
+    RenderCacheWriteList::iterator it = render_cache_writes.begin();
+    while (it != render_cache_writes.end()) {
+      if (it->hash == hash)
+        return; // already queued
+      if (interactive_resize && it->interactive
+          && it->header.fingerprint == header.fingerprint) {
+        render_cache_queued -= it->data.size();
+        it = render_cache_writes.erase(it);
+        continue;
+      }
+      ++it;
+    }
+
+    const unsigned long length = header.bytes_per_line * header.height;
+    if (render_cache_queued + length > render_cache_max_queued)
+      return;
+
+    render_cache_writes.push_back(RenderCacheWrite());
+    RenderCacheWrite &item = render_cache_writes.back();
+    item.header = header;
+    item.hash = hash;
+    item.data.assign(data, data + length);
+    item.interactive = interactive_resize;
+    render_cache_queued += length;
+  }
+
+
+  // removes the oldest files until bytes more fit in the directory
+  static void makeRoomInRenderCache(unsigned long bytes) {
+    while (!render_cache_index.empty()
+           && render_cache_bytes + bytes > render_cache_max_bytes) {
+      RenderCacheIndex::iterator oldest = render_cache_index.begin(),
+                                     it = oldest,
+                                    end = render_cache_index.end();
+      for (++it; it != end; ++it) {
+        if (it->second.olderThan(oldest->second))
+          oldest = it;
+      }
+      unlink(renderCachePath(oldest->first).c_str());
+      forgetRenderCacheFile(oldest);
+    }
+  }
+
+
+  static void saveRenderCache(const RenderCacheWrite &item) {
+    const unsigned long bytes = sizeof(item.header) + item.data.size();
+    if (bytes > render_cache_max_bytes)
+      return;
+    makeRoomInRenderCache(bytes);
+
+    // write to a private name first, other instances may be reading
+    const std::string path = renderCachePath(item.hash);
+    char suffix[32];
+    sprintf(suffix, ".%ld", static_cast<long>(getpid()));
+    const std::string tmp = path + suffix;
+
+    const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+      return;
+
+    const size_t length = item.data.size();
+    bool ok = (::write(fd, &item.header, sizeof(item.header))
+               == static_cast<ssize_t>(sizeof(item.header)))
+              && (::write(fd, &item.data[0], length)
+                  == static_cast<ssize_t>(length));
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+      unlink(tmp.c_str());
+      return;
+    }
+
+    RenderCacheFile file;
+    file.bytes = bytes;
+    file.mtime = time(0);
+    file.serial = ++render_cache_serial;
+    render_cache_index[item.hash] = file;
+    render_cache_bytes += bytes;
+  }
+
+
+  // removes every file in the cache directory
+  static void clearRenderCache(const std::string &dir) {
+    render_cache_index.clear();
+    render_cache_bytes = 0ul;
+
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+      return;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != 0) {
+      if (entry->d_name[0] == '.')
+        continue;
+      unlink((dir + entry->d_name).c_str());
+    }
+    closedir(d);
+  }
+#endif // HAVE_MMAP
+
 } // namespace bt
 
 
@@ -264,6 +934,19 @@ bt::XColorTable::XColorTable(const Display &dpy, unsigned int screen,
   const Colormap colormap = screeninfo.colormap();
 
   visual_class = visual->c_class;
+  switch (visual_class) {
+  case StaticGray:
+  case GrayScale:
+    kind = GrayVisual;
+    break;
+  case StaticColor:
+  case PseudoColor:
+    kind = IndexedVisual;
+    break;
+  default:
+    kind = DirectVisual;
+    break;
+  }
 
   bool query_colormap = false;
 
@@ -394,6 +1077,7 @@ bt::XColorTable::XColorTable(const Display &dpy, unsigned int screen,
     }
 
   case TrueColor:
+  case DirectColor:
     n_red   = right_align(visual->red_mask)   + 1;
     n_green = right_align(visual->green_mask) + 1;
     n_blue  = right_align(visual->blue_mask)  + 1;
@@ -401,14 +1085,22 @@ bt::XColorTable::XColorTable(const Display &dpy, unsigned int screen,
     red_shift = lowest_bit(visual->red_mask);
     green_shift = lowest_bit(visual->green_mask);
     blue_shift = lowest_bit(visual->blue_mask);
-    break;
 
-  case DirectColor:
-    // from libXmu...
-    n_red = n_green = n_blue = (visual->map_entries / 2) - 1;
+    for (unsigned int x = 0; x < 256; ++x) {
+      red_table[x]   = channelLevel(x, n_red)   << red_shift;
+      green_table[x] = channelLevel(x, n_green) << green_shift;
+      blue_table[x]  = channelLevel(x, n_blue)  << blue_shift;
+    }
     break;
   } // switch
 
+  // dithering is only needed (and the levels only fit in the dither
+  // table) when no channel has more than 256 levels and at least one
+  // has less
+  if (n_red <= 256u && n_green <= 256u && n_blue <= 256u
+      && (n_red < 256u || n_green < 256u || n_blue < 256u))
+    createDitherTable();
+
 #ifdef COLORTABLE_DEBUG
   switch (visual_class) {
   case StaticGray:
@@ -539,41 +1231,122 @@ bt::XColorTable::~XColorTable(void) {
 }
 
 
-void bt::XColorTable::map(unsigned int &red,
-                          unsigned int &green,
-                          unsigned int &blue) {
-  red   = (red   * n_red)   >> 8;
-  green = (green * n_green) >> 8;
-  blue  = (blue  * n_blue)  >> 8;
+unsigned long bt::Image::bufferAllocations(void)
+{ return render_allocations; }
+
+
+void bt::Image::trimRenderBuffers(void) {
+  RenderArenaList::const_iterator it = renderArenaList.begin(),
+                                 end = renderArenaList.end();
+  for (; it != end; ++it) {
+    if (*it)
+      (*it)->trim();
+  }
 }
 
 
-unsigned long bt::XColorTable::pixel(unsigned int red,
-                                     unsigned int green,
-                                     unsigned int blue) {
-  switch (visual_class) {
-  case StaticGray:
-  case GrayScale:
-    return colors[(red * 30 + green * 59 + blue * 11) / 100];
+bool bt::Image::isDithered(const Display &display, unsigned int screen)
+{ return findColorTable(display, screen)->ditherMode() != NoDither; }
 
-  case StaticColor:
-  case PseudoColor:
-    return colors[(red * n_green * n_blue) + (green * n_blue) + blue];
 
-  case TrueColor:
-  case DirectColor:
-    return ((red << red_shift)
-            | (green << green_shift)
-            | (blue << blue_shift));
+void bt::Image::setRenderCache(bool enabled, const std::string &stamp) {
+#ifdef    HAVE_MMAP
+  char version[32];
+  sprintf(version, "%u\n", render_cache_version);
+  const std::string contents = version + stamp + '\n';
+
+  // every screen loads the style, the directory is only read once
+  if (enabled && !render_cache_dir.empty() && contents == render_cache_stamp)
+    return;
+
+  render_cache_dir.clear();
+  render_cache_stamp.clear();
+  render_cache_index.clear();
+  render_cache_bytes = 0ul;
+  clearRenderCacheWrites();
+  if (!enabled)
+    return;
+
+  const std::string stamp_file =
+    XDG::BaseDir::writeCacheFile("blackbox/render/stamp");
+  if (stamp_file.empty())
+    return;
+  const std::string dir =
+    stamp_file.substr(0, stamp_file.length() - strlen("stamp"));
+
+  // empty the cache if the renderer or the stamp changed
+  std::string old_contents;
+  FILE *file = fopen(stamp_file.c_str(), "r");
+  if (file) {
+    char buf[1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0)
+      old_contents.append(buf, n);
+    fclose(file);
+  }
+  if (old_contents != contents) {
+    clearRenderCache(dir);
+    file = fopen(stamp_file.c_str(), "w");
+    if (!file)
+      return;
+    const bool ok = fputs(contents.c_str(), file) >= 0;
+    if (fclose(file) != 0 || !ok)
+      return;
+  } else {
+    loadRenderCacheIndex(dir);
   }
 
-  // not reached
-  return 0; // shut up compiler warning
+  render_cache_dir = dir;
+  render_cache_stamp = contents;
+#else
+  (void) enabled;
+  (void) stamp;
+#endif // HAVE_MMAP
+}
+
+
+bool bt::Image::writeRenderCache(void) {
+#ifdef    HAVE_MMAP
+  // images from an interactive resize wait until it is finished
+  RenderCacheWriteList::iterator it = render_cache_writes.begin(),
+                                end = render_cache_writes.end();
+  while (it != end && it->interactive)
+    ++it;
+  if (it == end)
+    return false;
+
+  saveRenderCache(*it);
+  render_cache_queued -= it->data.size();
+  it = render_cache_writes.erase(it);
+
+  while (it != end && it->interactive)
+    ++it;
+  return it != end;
+#else
+  return false;
+#endif // HAVE_MMAP
+}
+
+
+void bt::Image::setInteractiveResize(bool resizing) {
+#ifdef    HAVE_MMAP
+  interactive_resize = resizing;
+  if (resizing)
+    return;
+
+  // the last size of each texture is the one to keep
+  RenderCacheWriteList::iterator it = render_cache_writes.begin(),
+                                end = render_cache_writes.end();
+  for (; it != end; ++it)
+    it->interactive = false;
+#else
+  (void) resizing;
+#endif // HAVE_MMAP
 }
 
 
 bt::Image::Image(unsigned int w, unsigned int h)
-  : data(0), width(w), height(h)
+  : data(0), width(w), height(h), arena(0)
 {
   assert(width > 0);
   assert(height > 0);
@@ -581,8 +1354,9 @@ bt::Image::Image(unsigned int w, unsigned int h)
 
 
 bt::Image::~Image(void) {
-  delete [] data;
+  // the render buffers belong to the screen's arena
   data = 0;
+  arena = 0;
 }
 
 
@@ -595,14 +1369,51 @@ Pixmap bt::Image::render(const Display &display, unsigned int screen,
   if (!(texture.texture() & bt::Texture::Gradient))
     return None;
 
+  const Pixmap pixmap = renderSoftware(display, screen, texture);
+
+  unsigned int bw = 0;
+  if (texture.texture() & bt::Texture::Border) {
+    Pen penborder(screen, texture.borderColor());
+    bw = texture.borderWidth();
+
+    for (unsigned int i = 0; i < bw; ++i) {
+      XDrawRectangle(penborder.XDisplay(), pixmap, penborder.gc(),
+                     i, i, width - (i * 2) - 1, height - (i * 2) - 1);
+    }
+  }
+
+  return pixmap;
+}
+
+
+Pixmap bt::Image::renderSoftware(const Display &display, unsigned int screen,
+                                 const bt::Texture &texture) {
   const Color from = texture.color1(), to = texture.color2();
   const bool interlaced = texture.texture() & bt::Texture::Interlaced;
 
-  data = new RGB[width * height];
+  if (renderArenaList.empty())
+    renderArenaList.resize(display.screenCount(), 0);
 
-  if (texture.texture() & bt::Texture::Diagonal)
-    dgradient(from, to, interlaced);
-  else if (texture.texture() & bt::Texture::Elliptic)
+  if (!renderArenaList[screen])
+    renderArenaList[screen] = new RenderArena;
+
+#ifdef    HAVE_MMAP
+  RenderCacheHeader header;
+  const bool cached =
+    renderCacheHeader(display, screen, texture, width, height, header);
+  if (cached) {
+    Pixmap pixmap = loadRenderCache(display, screen, header);
+    if (pixmap)
+      return pixmap;
+  }
+#endif // HAVE_MMAP
+
+  arena = renderArenaList[screen];
+  data = arena->image.get(width * height);
+
+  if (texture.texture() & bt::Texture::Diagonal)
+    dgradient(from, to, interlaced);
+  else if (texture.texture() & bt::Texture::Elliptic)
     egradient(from, to, interlaced);
   else if (texture.texture() & bt::Texture::Horizontal)
     hgradient(from, to, interlaced);
@@ -624,18 +1435,14 @@ Pixmap bt::Image::render(const Display &display, unsigned int screen,
   else if (texture.texture() & bt::Texture::Sunken)
     sunkenBevel(texture.borderWidth());
 
-  Pixmap pixmap = renderPixmap(display, screen);
+#ifdef    HAVE_MMAP
+  Pixmap pixmap = renderPixmap(display, screen, cached ? &header : 0);
+#else
+  Pixmap pixmap = renderPixmap(display, screen, 0);
+#endif // HAVE_MMAP
 
-  unsigned int bw = 0;
-  if (texture.texture() & bt::Texture::Border) {
-    Pen penborder(screen, texture.borderColor());
-    bw = texture.borderWidth();
-
-    for (unsigned int i = 0; i < bw; ++i) {
-      XDrawRectangle(penborder.XDisplay(), pixmap, penborder.gc(),
-                     i, i, width - (i * 2) - 1, height - (i * 2) - 1);
-    }
-  }
+  arena->finishRender();
+  data = 0;
 
   return pixmap;
 }
@@ -680,116 +1487,383 @@ static const unsigned int dither16[16][16] = {
 };
 
 
+void bt::XColorTable::createDitherTable(void) {
+  dither_table.resize(3 * 65536);
+
+  unsigned int maxr = 255, maxg = 255, maxb = 255;
+  map(maxr, maxg, maxb);
+  const unsigned int r_scale = 256 * maxr + maxr + 1;
+  const unsigned int g_scale = 256 * maxg + maxg + 1;
+  const unsigned int b_scale = 256 * maxb + maxb + 1;
+
+  unsigned char *r_table = &dither_table[0];
+  unsigned char *g_table = &dither_table[65536];
+  unsigned char *b_table = &dither_table[131072];
+
+  for (unsigned int y = 0, x = 0; y < 16; ++y) {
+    for (unsigned int dithx = 0; dithx < 16; ++dithx) {
+      const unsigned int error = dither16[y][dithx];
+      for (unsigned int v = 0; v < 256; ++v, ++x) {
+        r_table[x] = (r_scale * v + error) / 65536;
+        g_table[x] = (g_scale * v + error) / 65536;
+        b_table[x] = (b_scale * v + error) / 65536;
+      }
+    }
+  }
+}
+
+
 /*
- * Helper function for TrueColorDither and renderXImage
+ * Pixel packers
  *
- * This handles the proper setting of the image data based on the image depth
- * and the machine's byte ordering
+ * The XImage writers are templates over the pixel format (bits per
+ * pixel plus one for MSB first byte order, as used by renderPixmap())
+ * and the visual kind of the color table.  The right instance is
+ * picked once per image, so the inner loops do not switch per pixel.
  */
-static void assignPixelData(unsigned int bit_depth, unsigned char **data,
-                            unsigned long pixel) {
-  unsigned char *pixel_data = *data;
-  switch (bit_depth) {
-  case  8: //  8bpp
-    pixel_data[0] = pixel;
-    ++pixel_data;
-    break;
+namespace bt {
 
-  case 16: // 16bpp LSB
-    pixel_data[0] = pixel;
-    pixel_data[1] = pixel >> 8;
-    pixel_data += 2;
-    break;
+  template <unsigned int Format>
+  struct PixelPacker;
 
-  case 17: // 16bpp MSB
-    pixel_data[0] = pixel >> 8;
-    pixel_data[1] = pixel;
-    pixel_data += 2;
-    break;
+  template <>
+  struct PixelPacker<8> { //  8bpp
+    static inline void put(unsigned char *&p, unsigned long pixel) {
+      p[0] = pixel;
+      p += 1;
+    }
+  };
 
-  case 24: // 24bpp LSB
-    pixel_data[0] = pixel;
-    pixel_data[1] = pixel >> 8;
-    pixel_data[2] = pixel >> 16;
-    pixel_data += 3;
-    break;
+  template <>
+  struct PixelPacker<16> { // 16bpp LSB
+    static inline void put(unsigned char *&p, unsigned long pixel) {
+      p[0] = pixel;
+      p[1] = pixel >> 8;
+      p += 2;
+    }
+  };
 
-  case 25: // 24bpp MSB
-    pixel_data[0] = pixel >> 16;
-    pixel_data[1] = pixel >> 8;
-    pixel_data[2] = pixel;
-    pixel_data += 3;
-    break;
+  template <>
+  struct PixelPacker<17> { // 16bpp MSB
+    static inline void put(unsigned char *&p, unsigned long pixel) {
+      p[0] = pixel >> 8;
+      p[1] = pixel;
+      p += 2;
+    }
+  };
 
-  case 32: // 32bpp LSB
-    pixel_data[0] = pixel;
-    pixel_data[1] = pixel >> 8;
-    pixel_data[2] = pixel >> 16;
-    pixel_data[3] = pixel >> 24;
-    pixel_data += 4;
-    break;
+  template <>
+  struct PixelPacker<24> { // 24bpp LSB
+    static inline void put(unsigned char *&p, unsigned long pixel) {
+      p[0] = pixel;
+      p[1] = pixel >> 8;
+      p[2] = pixel >> 16;
+      p += 3;
+    }
+  };
 
-  case 33: // 32bpp MSB
-    pixel_data[0] = pixel >> 24;
-    pixel_data[1] = pixel >> 16;
-    pixel_data[2] = pixel >> 8;
-    pixel_data[3] = pixel;
-    pixel_data += 4;
-    break;
+  template <>
+  struct PixelPacker<25> { // 24bpp MSB
+    static inline void put(unsigned char *&p, unsigned long pixel) {
+      p[0] = pixel >> 16;
+      p[1] = pixel >> 8;
+      p[2] = pixel;
+      p += 3;
+    }
+  };
+
+  template <>
+  struct PixelPacker<32> { // 32bpp LSB
+    static inline void put(unsigned char *&p, unsigned long pixel) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      // the image byte order matches ours, store the whole word
+      const unsigned int word = pixel;
+      memcpy(p, &word, 4);
+#else
+      p[0] = pixel;
+      p[1] = pixel >> 8;
+      p[2] = pixel >> 16;
+      p[3] = pixel >> 24;
+#endif
+      p += 4;
+    }
+  };
+
+  template <>
+  struct PixelPacker<33> { // 32bpp MSB
+    static inline void put(unsigned char *&p, unsigned long pixel) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      const unsigned int word = pixel;
+      memcpy(p, &word, 4);
+#else
+      p[0] = pixel >> 24;
+      p[1] = pixel >> 16;
+      p[2] = pixel >> 8;
+      p[3] = pixel;
+#endif
+      p += 4;
+    }
+  };
+
+
+  // get() takes colors already mapped by the color table, unmapped()
+  // takes 8 bit channel values
+  template <int Kind>
+  struct VisualPixel;
+
+  template <>
+  struct VisualPixel<XColorTable::GrayVisual> {
+    static inline unsigned long get(const XColorTable &colortable,
+                                    unsigned int r,
+                                    unsigned int g,
+                                    unsigned int b)
+    { return colortable.grayPixel(r, g, b); }
+    static inline unsigned long unmapped(const XColorTable &colortable,
+                                         unsigned int r,
+                                         unsigned int g,
+                                         unsigned int b) {
+      colortable.map(r, g, b);
+      return colortable.grayPixel(r, g, b);
+    }
+  };
+
+  template <>
+  struct VisualPixel<XColorTable::IndexedVisual> {
+    static inline unsigned long get(const XColorTable &colortable,
+                                    unsigned int r,
+                                    unsigned int g,
+                                    unsigned int b)
+    { return colortable.indexedPixel(r, g, b); }
+    static inline unsigned long unmapped(const XColorTable &colortable,
+                                         unsigned int r,
+                                         unsigned int g,
+                                         unsigned int b) {
+      colortable.map(r, g, b);
+      return colortable.indexedPixel(r, g, b);
+    }
+  };
+
+  template <>
+  struct VisualPixel<XColorTable::DirectVisual> {
+    static inline unsigned long get(const XColorTable &colortable,
+                                    unsigned int r,
+                                    unsigned int g,
+                                    unsigned int b)
+    { return colortable.directPixel(r, g, b); }
+    static inline unsigned long unmapped(const XColorTable &colortable,
+                                         unsigned int r,
+                                         unsigned int g,
+                                         unsigned int b)
+    { return colortable.truePixel(r, g, b); }
+  };
+
+
+  template <unsigned int Format, int Kind>
+  static void renderNoDither(const XColorTable &colortable, const RGB *data,
+                             unsigned int width, unsigned int height,
+                             unsigned int bytes_per_line,
+                             unsigned char *pixel_data) {
+    unsigned int x, y;
+    unsigned char *ppixel_data = pixel_data;
+
+    for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x, ++data) {
+        PixelPacker<Format>::put(pixel_data,
+                                 VisualPixel<Kind>::unmapped(colortable,
+                                                             data->red,
+                                                             data->green,
+                                                             data->blue));
+      }
+
+      pixel_data = (ppixel_data += bytes_per_line);
+    }
   }
-  *data = pixel_data; // assign back so we don't lose our place
-}
 
 
-// algorithm: ordered dithering... many many thanks to rasterman
-// (raster@rasterman.com) for telling me about this... portions of this
-// code is based off of his code in Imlib
+  // algorithm: ordered dithering... many many thanks to rasterman
+  // (raster@rasterman.com) for telling me about this... portions of this
+  // code is based off of his code in Imlib
+  template <unsigned int Format, int Kind>
+  static void renderOrderedDither(const XColorTable &colortable,
+                                  const RGB *data,
+                                  unsigned int width, unsigned int height,
+                                  unsigned int bytes_per_line,
+                                  unsigned char *pixel_data) {
+    unsigned int x, y, dithy, offset, r, g, b;
+    unsigned char *ppixel_data = pixel_data;
+
+    const unsigned char * const r_table = colortable.redDither();
+    const unsigned char * const g_table = colortable.greenDither();
+    const unsigned char * const b_table = colortable.blueDither();
+
+    for (y = 0; y < height; ++y) {
+      dithy = (y & 15) * 16 * 256;
+
+      for (x = 0; x < width; ++x, ++data) {
+        offset = dithy + (x & 15) * 256;
+
+        r = r_table[offset + data->red];
+        g = g_table[offset + data->green];
+        b = b_table[offset + data->blue];
+
+        PixelPacker<Format>::put(pixel_data,
+                                 VisualPixel<Kind>::get(colortable, r, g, b));
+      }
+
+      pixel_data = (ppixel_data += bytes_per_line);
+    }
+  }
+
+
+  // packs one line of already mapped colors, used by the Floyd-Steinberg
+  // dither
+  template <unsigned int Format, int Kind>
+  static void packMappedLine(const XColorTable &colortable, const RGB *line,
+                             unsigned int width, unsigned char *pixel_data) {
+    for (unsigned int x = 0; x < width; ++x, ++line) {
+      PixelPacker<Format>::put(pixel_data,
+                               VisualPixel<Kind>::get(colortable,
+                                                      line->red,
+                                                      line->green,
+                                                      line->blue));
+    }
+  }
+
+
+  typedef void (*ImageWriter)(const XColorTable &colortable, const RGB *data,
+                              unsigned int width, unsigned int height,
+                              unsigned int bytes_per_line,
+                              unsigned char *pixel_data);
+  typedef void (*LineWriter)(const XColorTable &colortable, const RGB *line,
+                             unsigned int width, unsigned char *pixel_data);
+
+  struct PixelWriters {
+    ImageWriter nodither;
+    ImageWriter ordered;
+    LineWriter mappedLine;
+  };
+
+#define PIXEL_WRITERS(format, kind)                             \
+  { renderNoDither<format, XColorTable::kind>,                  \
+    renderOrderedDither<format, XColorTable::kind>,             \
+    packMappedLine<format, XColorTable::kind> }
+#define PIXEL_WRITERS_FOR_FORMAT(format)                        \
+  { PIXEL_WRITERS(format, GrayVisual),                          \
+    PIXEL_WRITERS(format, IndexedVisual),                       \
+    PIXEL_WRITERS(format, DirectVisual) }
+
+  static const PixelWriters pixel_writers[7][3] = {
+    PIXEL_WRITERS_FOR_FORMAT(8),
+    PIXEL_WRITERS_FOR_FORMAT(16),
+    PIXEL_WRITERS_FOR_FORMAT(17),
+    PIXEL_WRITERS_FOR_FORMAT(24),
+    PIXEL_WRITERS_FOR_FORMAT(25),
+    PIXEL_WRITERS_FOR_FORMAT(32),
+    PIXEL_WRITERS_FOR_FORMAT(33)
+  };
+
+#undef PIXEL_WRITERS_FOR_FORMAT
+#undef PIXEL_WRITERS
+
+  static const PixelWriters *findPixelWriters(unsigned int format,
+                                              const XColorTable &colortable) {
+    unsigned int f;
+    switch (format) {
+    case  8: f = 0; break;
+    case 16: f = 1; break;
+    case 17: f = 2; break;
+    case 24: f = 3; break;
+    case 25: f = 4; break;
+    case 32: f = 5; break;
+    case 33: f = 6; break;
+    default: return 0; // unsupported pixel format
+    }
+    return &pixel_writers[f][colortable.visualKind()];
+  }
+
+} // namespace bt
+
+
 void bt::Image::OrderedDither(XColorTable *colortable,
                               unsigned int bit_depth,
                               unsigned int bytes_per_line,
                               unsigned char *pixel_data) {
-  unsigned int x, y, dithx, dithy, r, g, b, error, offset;
-  unsigned char *ppixel_data = pixel_data;
-
-  unsigned int maxr = 255, maxg = 255, maxb = 255;
-  colortable->map(maxr, maxg, maxb);
+  const PixelWriters *writers = findPixelWriters(bit_depth, *colortable);
+  if (!writers)
+    return;
+  writers->ordered(*colortable, data, width, height,
+                   bytes_per_line, pixel_data);
+}
 
-  for (y = 0, offset = 0; y < height; ++y) {
-    dithy = y & 15;
+namespace bt {
 
-    for (x = 0; x < width; ++x, ++offset) {
-      dithx = x & 15;
+  /*
+    One color channel of the Floyd-Steinberg dither.  The error for the
+    next pixel on the current line is carried in 'carry', the errors for
+    the pixels behind and at the current position on the next line are
+    accumulated in 'behind' and 'here' and only written to the error line
+    once complete.  The sixteenths are rounded to nearest, so the error
+    spread does not drift towards black or white.
+  */
+  struct DitherChannel {
+    const short *line1;
+    short *line2;
+    const unsigned char *level; // clamped value -> mapped level
+    const short *value;         // clamped value -> value of mapped level
+    int carry, behind, here;
+
+    inline void start(const short *l1, short *l2) {
+      line1 = l1;
+      line2 = l2;
+      carry = behind = here = 0;
+    }
 
-      error = dither16[dithy][dithx];
+    inline unsigned int dither(int x, int step) {
+      const int v = line1[x] + carry;
+      const int c = std::max(std::min(v, 255), 0);
+      const int err = v - value[c];
 
-      r = (((256 * maxr + maxr + 1) * data[offset].red   + error) / 65536);
-      g = (((256 * maxg + maxg + 1) * data[offset].green + error) / 65536);
-      b = (((256 * maxb + maxb + 1) * data[offset].blue  + error) / 65536);
+      carry = (err * 7 + 8) >> 4;
+      line2[x - step] += behind + ((err * 3 + 8) >> 4);
+      behind = here + ((err * 5 + 8) >> 4);
+      here = (err + 8) >> 4;
+      return level[c];
+    }
 
-      assignPixelData(bit_depth, &pixel_data, colortable->pixel(r, g, b));
+    inline void finish(int x) {
+      // x is the last pixel on the line, 'here' would go past the end
+      line2[x] += behind;
     }
+  };
 
-    pixel_data = (ppixel_data += bytes_per_line);
-  }
-}
+} // namespace bt
 
 
 void bt::Image::FloydSteinbergDither(XColorTable *colortable,
                                      unsigned int bit_depth,
                                      unsigned int bytes_per_line,
                                      unsigned char *pixel_data) {
-  int * const error = new int[width * 6];
-  int * const r_line1 = error + (width * 0);
-  int * const g_line1 = error + (width * 1);
-  int * const b_line1 = error + (width * 2);
-  int * const r_line2 = error + (width * 3);
-  int * const g_line2 = error + (width * 4);
-  int * const b_line2 = error + (width * 5);
-
-  int rer, ger, ber;
-  unsigned int x, y, r, g, b, offset;
+  const PixelWriters *writers = findPixelWriters(bit_depth, *colortable);
+  if (!writers)
+    return;
+
+  // the error lines have an unused entry at each end, so spreading the
+  // error does not need to check for the edges of the image
+  const unsigned int stride = width + 2;
+  ditherErrors.resize(stride * 6);
+  ditherLine.resize(width);
+
+  short * const error = &ditherErrors[0];
+  short * const r_line1 = error + (stride * 0) + 1;
+  short * const g_line1 = error + (stride * 1) + 1;
+  short * const b_line1 = error + (stride * 2) + 1;
+  short * const r_line2 = error + (stride * 3) + 1;
+  short * const g_line2 = error + (stride * 4) + 1;
+  short * const b_line2 = error + (stride * 5) + 1;
+
+  unsigned int x, y, offset;
   unsigned char *ppixel_data = pixel_data;
-  RGB *pixels = new RGB[width];
+  RGB * const pixels = &ditherLine[0];
 
   unsigned int maxr = 255, maxg = 255, maxb = 255;
   colortable->map(maxr, maxg, maxb);
@@ -797,124 +1871,92 @@ void bt::Image::FloydSteinbergDither(XColorTable *colortable,
   maxg = 255u / maxg;
   maxb = 255u / maxb;
 
+  unsigned char r_level[256], g_level[256], b_level[256];
+  short r_value[256], g_value[256], b_value[256];
+  for (x = 0; x < 256; ++x) {
+    unsigned int r = x, g = x, b = x;
+    colortable->map(r, g, b);
+    r_level[x] = r;
+    g_level[x] = g;
+    b_level[x] = b;
+    r_value[x] = r * maxr;
+    g_value[x] = g * maxg;
+    b_value[x] = b * maxb;
+  }
+
+  DitherChannel red   = { 0, 0, r_level, r_value, 0, 0, 0 };
+  DitherChannel green = { 0, 0, g_level, g_value, 0, 0, 0 };
+  DitherChannel blue  = { 0, 0, b_level, b_value, 0, 0, 0 };
+
   for (y = 0, offset = 0; y < height; ++y) {
     const bool reverse = bool(y & 1);
 
-    int * const rl1 = (reverse) ? r_line2 : r_line1;
-    int * const gl1 = (reverse) ? g_line2 : g_line1;
-    int * const bl1 = (reverse) ? b_line2 : b_line1;
-    int * const rl2 = (reverse) ? r_line1 : r_line2;
-    int * const gl2 = (reverse) ? g_line1 : g_line2;
-    int * const bl2 = (reverse) ? b_line1 : b_line2;
+    short * const rl1 = (reverse) ? r_line2 : r_line1;
+    short * const gl1 = (reverse) ? g_line2 : g_line1;
+    short * const bl1 = (reverse) ? b_line2 : b_line1;
+    short * const rl2 = (reverse) ? r_line1 : r_line2;
+    short * const gl2 = (reverse) ? g_line1 : g_line2;
+    short * const bl2 = (reverse) ? b_line1 : b_line2;
 
     if (y == 0) {
       for (x = 0; x < width; ++x) {
-        rl1[x] = static_cast<int>(data[x].red);
-        gl1[x] = static_cast<int>(data[x].green);
-        bl1[x] = static_cast<int>(data[x].blue);
+        rl1[x] = data[x].red;
+        gl1[x] = data[x].green;
+        bl1[x] = data[x].blue;
       }
     }
     if (y+1 < height) {
+      const RGB * const next = data + offset + width;
       for (x = 0; x < width; ++x) {
-        rl2[x] = static_cast<int>(data[offset + width + x].red);
-        gl2[x] = static_cast<int>(data[offset + width + x].green);
-        bl2[x] = static_cast<int>(data[offset + width + x].blue);
+        rl2[x] = next[x].red;
+        gl2[x] = next[x].green;
+        bl2[x] = next[x].blue;
       }
     }
 
-    // bi-directional dither
+    red.start(rl1, rl2);
+    green.start(gl1, gl2);
+    blue.start(bl1, bl2);
+
+    // bi-directional dither, the error is spread in sixteenths: 7 to the
+    // next pixel on this line and 3, 5, 1 to the pixels on the next line
     if (reverse) {
       for (x = 0; x < width; ++x) {
-        r = static_cast<unsigned int>(std::max(std::min(rl1[x], 255), 0));
-        g = static_cast<unsigned int>(std::max(std::min(gl1[x], 255), 0));
-        b = static_cast<unsigned int>(std::max(std::min(bl1[x], 255), 0));
-
-        colortable->map(r, g, b);
-
-        pixels[x].red   = r;
-        pixels[x].green = g;
-        pixels[x].blue  = b;
-
-        rer = rl1[x] - static_cast<int>(r * maxr);
-        ger = gl1[x] - static_cast<int>(g * maxg);
-        ber = bl1[x] - static_cast<int>(b * maxb);
-
-        if (x+1 < width) {
-          rl1[x+1] += rer * 7 / 16;
-          gl1[x+1] += ger * 7 / 16;
-          bl1[x+1] += ber * 7 / 16;
-          rl2[x+1] += rer * 1 / 16;
-          gl2[x+1] += ger * 1 / 16;
-          bl2[x+1] += ber * 1 / 16;
-        }
-        rl2[x] += rer * 5 / 16;
-        gl2[x] += ger * 5 / 16;
-        bl2[x] += ber * 5 / 16;
-        if (x > 0) {
-          rl2[x-1] += rer * 3 / 16;
-          gl2[x-1] += ger * 3 / 16;
-          bl2[x-1] += ber * 3 / 16;
-        }
+        RGB pixel;
+        pixel.red      = red.dither(x, 1);
+        pixel.green    = green.dither(x, 1);
+        pixel.blue     = blue.dither(x, 1);
+        pixel.reserved = 0;
+        pixels[x] = pixel;
       }
+      red.finish(width - 1);
+      green.finish(width - 1);
+      blue.finish(width - 1);
     } else {
       for (x = width; x-- > 0; ) {
-        r = static_cast<unsigned int>(std::max(std::min(rl1[x], 255), 0));
-        g = static_cast<unsigned int>(std::max(std::min(gl1[x], 255), 0));
-        b = static_cast<unsigned int>(std::max(std::min(bl1[x], 255), 0));
-
-        colortable->map(r, g, b);
-
-        pixels[x].red   = r;
-        pixels[x].green = g;
-        pixels[x].blue  = b;
-
-        rer = rl1[x] - static_cast<int>(r * maxr);
-        ger = gl1[x] - static_cast<int>(g * maxg);
-        ber = bl1[x] - static_cast<int>(b * maxb);
-
-        if (x > 0) {
-          rl1[x-1] += rer * 7 / 16;
-          gl1[x-1] += ger * 7 / 16;
-          bl1[x-1] += ber * 7 / 16;
-          rl2[x-1] += rer * 1 / 16;
-          gl2[x-1] += ger * 1 / 16;
-          bl2[x-1] += ber * 1 / 16;
-        }
-        rl2[x] += rer * 5 / 16;
-        gl2[x] += ger * 5 / 16;
-        bl2[x] += ber * 5 / 16;
-        if (x+1 < width) {
-          rl2[x+1] += rer * 3 / 16;
-          gl2[x+1] += ger * 3 / 16;
-          bl2[x+1] += ber * 3 / 16;
-        }
+        RGB pixel;
+        pixel.red      = red.dither(x, -1);
+        pixel.green    = green.dither(x, -1);
+        pixel.blue     = blue.dither(x, -1);
+        pixel.reserved = 0;
+        pixels[x] = pixel;
       }
+      red.finish(0);
+      green.finish(0);
+      blue.finish(0);
     }
-    for (x = 0; x < width; ++x) {
-      r = pixels[x].red;
-      g = pixels[x].green;
-      b = pixels[x].blue;
-      assignPixelData(bit_depth, &pixel_data, colortable->pixel(r, g, b));
-    }
+
+    writers->mappedLine(*colortable, pixels, width, pixel_data);
 
     offset += width;
     pixel_data = (ppixel_data += bytes_per_line);
   }
-
-  delete [] error;
-  delete [] pixels;
 }
 
 
-Pixmap bt::Image::renderPixmap(const Display &display, unsigned int screen) {
-  // get the colortable for the screen. if necessary, we will create one.
-  if (colorTableList.empty())
-    colorTableList.resize(display.screenCount(), 0);
-
-  if (!colorTableList[screen])
-    colorTableList[screen] = new XColorTable(display, screen, maximumColors());
-
-  XColorTable *colortable = colorTableList[screen];
+Pixmap bt::Image::renderPixmap(const Display &display, unsigned int screen,
+                               const RenderCacheHeader *cache_header) {
+  XColorTable *colortable = findColorTable(display, screen);
   const ScreenInfo &screeninfo = display.screenInfo(screen);
   XImage *image = 0;
   bool shm_ok = false;
@@ -957,28 +1999,32 @@ Pixmap bt::Image::renderPixmap(const Display &display, unsigned int screen) {
     break;
 
   case bt::NoDither: {
-    unsigned int x, y, offset, r, g, b;
-    unsigned char *pixel_data = d, *ppixel_data = d;
-
-    for (y = 0, offset = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++offset) {
-        r = data[offset].red;
-        g = data[offset].green;
-        b = data[offset].blue;
-
-        colortable->map(r, g, b);
-        assignPixelData(o, &pixel_data, colortable->pixel(r, g, b));
-      }
-
-      pixel_data = (ppixel_data += image->bytes_per_line);
-    }
+    const PixelWriters *writers = findPixelWriters(o, *colortable);
+    if (writers)
+      writers->nodither(*colortable, data, width, height,
+                        image->bytes_per_line, d);
     break;
   }
   } // switch dmode
 
+#ifdef    HAVE_MMAP
+  if (cache_header
+      && static_cast<int>(cache_header->bytes_per_line)
+         == image->bytes_per_line)
+    queueRenderCache(*cache_header, image->data);
+#else
+  (void) cache_header;
+#endif // HAVE_MMAP
+
   Pixmap pixmap = XCreatePixmap(display.XDisplay(), screeninfo.rootWindow(),
                                 width, height, screeninfo.depth());
   if (pixmap == None) {
+#ifdef MITSHM
+    if (shm_ok) {
+      destroyShmImage(image, false);
+      return None;
+    }
+#endif // MITSHM
     image->data = 0;
     XDestroyImage(image);
 
@@ -991,9 +2037,9 @@ Pixmap bt::Image::renderPixmap(const Display &display, unsigned int screen) {
   if (shm_ok) {
     // use MIT-SHM extension
     XShmPutImage(pen.XDisplay(), pixmap, pen.gc(), image,
-                 0, 0, 0, 0, width, height, False);
+                 0, 0, 0, 0, width, height, True);
 
-    destroyShmImage(display, image);
+    destroyShmImage(image, true);
   } else
 #endif // MITSHM
     {
@@ -1197,85 +2243,160 @@ void bt::Image::sunkenBevel(unsigned int border_width) {
 }
 
 
-void bt::Image::dgradient(const Color &from, const Color &to,
-                          bool interlaced) {
-  // diagonal gradient code was written by Mike Cole <mike@mydot.com>
-  // modified for interlacing by Brad Hughes
+/*
+ * Gradient kernels
+ *
+ * The table driven gradients build per-axis color tables and then
+ * combine them for every pixel.  The combine step is done by one of
+ * the kernel sets below, which is chosen at startup based on the
+ * features of the CPU.  The scalar kernels are the reference
+ * implementation; the SIMD kernels must produce identical red, green
+ * and blue values.
+ */
+namespace bt {
 
-  double drx, dgx, dbx, dry, dgy, dby;
-  double yr = 0.0, yg = 0.0, yb = 0.0,
-         xr = static_cast<double>(from.red()),
-         xg = static_cast<double>(from.green()),
-         xb = static_cast<double>(from.blue());
+  struct GradientTables {
+    const unsigned int *xt[3];
+    const unsigned int *yt[3];
+    unsigned int to[3];
+    int sign[3];
+  };
 
-  RGB *p = data;
-  unsigned int w = width * 2, h = height * 2;
-  unsigned int x, y;
+  typedef void (*CombineKernel)(RGB *data,
+                                unsigned int width, unsigned int height,
+                                const GradientTables &tables,
+                                bool interlaced);
+  typedef void (*FillKernel)(RGB *p, const RGB &rgb, unsigned int count);
+
+  struct RenderKernels {
+    const char *name;
+    CombineKernel diagonal;   // dgradient, cdgradient
+    CombineKernel pyramid;    // pgradient
+    CombineKernel rectangle;  // rgradient
+    CombineKernel pipecross;  // pcgradient
+    CombineKernel elliptic;   // egradient
+    FillKernel fill;          // partial_vgradient
+  };
 
-  const unsigned int dimension = std::max(width, height);
-  unsigned int *alloc = new unsigned int[dimension * 6];
-  unsigned int *xt[3], *yt[3];
-  xt[0] = alloc + (dimension * 0);
-  xt[1] = alloc + (dimension * 1);
-  xt[2] = alloc + (dimension * 2);
-  yt[0] = alloc + (dimension * 3);
-  yt[1] = alloc + (dimension * 4);
-  yt[2] = alloc + (dimension * 5);
 
-  dry = drx = static_cast<double>(to.red()   - from.red());
-  dgy = dgx = static_cast<double>(to.green() - from.green());
-  dby = dbx = static_cast<double>(to.blue()  - from.blue());
+  static void scalarDiagonal(RGB *p, unsigned int width, unsigned int height,
+                             const GradientTables &t, bool interlaced) {
+    unsigned int x, y;
+
+    if (!interlaced) {
+      // normal dgradient
+      for (y = 0; y < height; ++y) {
+        for (x = 0; x < width; ++x, ++p) {
+          p->red   = t.xt[0][x] + t.yt[0][y];
+          p->green = t.xt[1][x] + t.yt[1][y];
+          p->blue  = t.xt[2][x] + t.yt[2][y];
+        }
+      }
+    } else {
+      // interlacing effect
+      for (y = 0; y < height; ++y) {
+        for (x = 0; x < width; ++x, ++p) {
+          p->red   = t.xt[0][x] + t.yt[0][y];
+          p->green = t.xt[1][x] + t.yt[1][y];
+          p->blue  = t.xt[2][x] + t.yt[2][y];
+
+          if (y & 1) {
+            p->red   = (p->red   >> 1) + (p->red   >> 2);
+            p->green = (p->green >> 1) + (p->green >> 2);
+            p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
+          }
+        }
+      }
+    }
+  }
+
 
-  // Create X table
-  drx /= w;
-  dgx /= w;
-  dbx /= w;
+  static void scalarPyramid(RGB *p, unsigned int width, unsigned int height,
+                            const GradientTables &t, bool interlaced) {
+    unsigned int x, y;
 
-  for (x = 0; x < width; ++x) {
-    xt[0][x] = static_cast<unsigned char>(xr);
-    xt[1][x] = static_cast<unsigned char>(xg);
-    xt[2][x] = static_cast<unsigned char>(xb);
+    for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x, ++p) {
+        p->red = static_cast<unsigned char>
+                 (t.to[0] - (t.sign[0] * (t.xt[0][x] + t.yt[0][y])));
+        p->green = static_cast<unsigned char>
+                   (t.to[1] - (t.sign[1] * (t.xt[1][x] + t.yt[1][y])));
+        p->blue = static_cast<unsigned char>
+                  (t.to[2] - (t.sign[2] * (t.xt[2][x] + t.yt[2][y])));
 
-    xr += drx;
-    xg += dgx;
-    xb += dbx;
+        if (interlaced && (y & 1)) {
+          p->red   = (p->red   >> 1) + (p->red   >> 2);
+          p->green = (p->green >> 1) + (p->green >> 2);
+          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
+        }
+      }
+    }
   }
 
-  // Create Y table
-  dry /= h;
-  dgy /= h;
-  dby /= h;
 
-  for (y = 0; y < height; ++y) {
-    yt[0][y] = static_cast<unsigned char>(yr);
-    yt[1][y] = static_cast<unsigned char>(yg);
-    yt[2][y] = static_cast<unsigned char>(yb);
+  static void scalarRectangle(RGB *p, unsigned int width, unsigned int height,
+                              const GradientTables &t, bool interlaced) {
+    unsigned int x, y;
+
+    for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x, ++p) {
+        p->red = static_cast<unsigned char>
+                 (t.to[0] - (t.sign[0] * std::max(t.xt[0][x], t.yt[0][y])));
+        p->green = static_cast<unsigned char>
+                   (t.to[1] - (t.sign[1] * std::max(t.xt[1][x], t.yt[1][y])));
+        p->blue = static_cast<unsigned char>
+                  (t.to[2] - (t.sign[2] * std::max(t.xt[2][x], t.yt[2][y])));
 
-    yr += dry;
-    yg += dgy;
-    yb += dby;
+        if (interlaced && (y & 1)) {
+          p->red   = (p->red   >> 1) + (p->red   >> 2);
+          p->green = (p->green >> 1) + (p->green >> 2);
+          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
+        }
+      }
+    }
   }
 
-  // Combine tables to create gradient
 
-  if (!interlaced) {
-    // normal dgradient
+  static void scalarPipeCross(RGB *p, unsigned int width, unsigned int height,
+                              const GradientTables &t, bool interlaced) {
+    unsigned int x, y;
+
     for (y = 0; y < height; ++y) {
       for (x = 0; x < width; ++x, ++p) {
-        p->red   = xt[0][x] + yt[0][y];
-        p->green = xt[1][x] + yt[1][y];
-        p->blue  = xt[2][x] + yt[2][y];
+        p->red = static_cast<unsigned char>
+                 (t.to[0] - (t.sign[0] * std::min(t.xt[0][x], t.yt[0][y])));
+        p->green = static_cast<unsigned char>
+                   (t.to[1] - (t.sign[1] * std::min(t.xt[1][x], t.yt[1][y])));
+        p->blue = static_cast<unsigned char>
+                  (t.to[2] - (t.sign[2] * std::min(t.xt[2][x], t.yt[2][y])));
+
+        if (interlaced && (y & 1)) {
+          p->red   = (p->red   >> 1) + (p->red   >> 2);
+          p->green = (p->green >> 1) + (p->green >> 2);
+          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
+        }
       }
     }
-  } else {
-    // interlacing effect
+  }
+
+
+  static void scalarElliptic(RGB *p, unsigned int width, unsigned int height,
+                             const GradientTables &t, bool interlaced) {
+    unsigned int x, y;
+
     for (y = 0; y < height; ++y) {
       for (x = 0; x < width; ++x, ++p) {
-        p->red   = xt[0][x] + yt[0][y];
-        p->green = xt[1][x] + yt[1][y];
-        p->blue  = xt[2][x] + yt[2][y];
+        p->red   = static_cast<unsigned char>
+                   (t.to[0] - (t.sign[0] * static_cast<int>
+                               (sqrt(t.xt[0][x] + t.yt[0][y]))));
+        p->green = static_cast<unsigned char>
+                   (t.to[1] - (t.sign[1] * static_cast<int>
+                               (sqrt(t.xt[1][x] + t.yt[1][y]))));
+        p->blue  = static_cast<unsigned char>
+                   (t.to[2] - (t.sign[2] * static_cast<int>
+                               (sqrt(t.xt[2][x] + t.yt[2][y]))));
 
-        if (y & 1) {
+        if (interlaced && (y & 1)) {
           p->red   = (p->red   >> 1) + (p->red   >> 2);
           p->green = (p->green >> 1) + (p->green >> 2);
           p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
@@ -1284,261 +2405,475 @@ void bt::Image::dgradient(const Color &from, const Color &to,
     }
   }
 
-  delete [] alloc;
-}
 
+  static void scalarFill(RGB *p, const RGB &rgb, unsigned int count) {
+    for (unsigned int x = 0; x < count; ++x, ++p)
+      *p = rgb;
+  }
 
-void bt::Image::hgradient(const Color &from, const Color &to,
-                          bool interlaced) {
-  double drx, dgx, dbx,
-    xr = static_cast<double>(from.red()),
-    xg = static_cast<double>(from.green()),
-    xb = static_cast<double>(from.blue());
-  RGB *p = data;
-  unsigned int total = width * (height - 2);
-  unsigned int x;
 
-  drx = static_cast<double>(to.red()   - from.red());
-  dgx = static_cast<double>(to.green() - from.green());
-  dbx = static_cast<double>(to.blue()  - from.blue());
+  static const RenderKernels scalar_kernels = {
+    "scalar",
+    scalarDiagonal,
+    scalarPyramid,
+    scalarRectangle,
+    scalarPipeCross,
+    scalarElliptic,
+    scalarFill
+  };
 
-  drx /= width;
-  dgx /= width;
-  dbx /= width;
 
-  if (interlaced && height > 1) {
-    // interlacing effect
+#ifdef SIMD_X86
+  /*
+    The SIMD kernels work on whole pixels, treating each RGB as 4
+    packed bytes.  All table driven gradients except the elliptic one
+    reduce to
 
-    // first line
-    for (x = 0; x < width; ++x, ++p) {
-      p->red   = static_cast<unsigned char>(xr);
-      p->green = static_cast<unsigned char>(xg);
-      p->blue  = static_cast<unsigned char>(xb);
+        to - sign * op(xt, yt)    (mod 256, per channel)
 
-      xr += drx;
-      xg += dgx;
-      xb += dbx;
-    }
+    where op is a sum, or twice the maximum or minimum.  Negating a
+    byte is done with (v ^ 0xff) - 0xff, so the per-channel sign turns
+    into a byte mask.  The diagonal gradients pass to = 0 and a
+    negative sign, which leaves the plain sum.
+  */
+  enum CombineOp { CombineSum, CombineMax, CombineMin };
 
-    // second line
-    xr = static_cast<double>(from.red()),
-    xg = static_cast<double>(from.green()),
-    xb = static_cast<double>(from.blue());
+  // scratch space for the packed x table
+  static std::vector<RGB> packed_xtable;
 
-    for (x = 0; x < width; ++x, ++p) {
-      p->red   = static_cast<unsigned char>(xr);
-      p->green = static_cast<unsigned char>(xg);
-      p->blue  = static_cast<unsigned char>(xb);
+  static inline unsigned int packedRGB(const RGB &rgb) {
+    unsigned int word;
+    memcpy(&word, &rgb, sizeof(word));
+    return word;
+  }
 
-      p->red   = (p->red   >> 1) + (p->red   >> 2);
-      p->green = (p->green >> 1) + (p->green >> 2);
-      p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
+  static inline RGB makeRGB(unsigned int r, unsigned int g, unsigned int b) {
+    RGB rgb;
+    rgb.red = r;
+    rgb.green = g;
+    rgb.blue = b;
+    rgb.reserved = 0;
+    return rgb;
+  }
 
-      xr += drx;
-      xg += dgx;
-      xb += dbx;
-    }
-  } else {
-    // first line
-    for (x = 0; x < width; ++x, ++p) {
-      p->red   = static_cast<unsigned char>(xr);
-      p->green = static_cast<unsigned char>(xg);
-      p->blue  = static_cast<unsigned char>(xb);
+  static const RGB *packXTable(const GradientTables &t, unsigned int width) {
+    packed_xtable.resize(width);
+    for (unsigned int x = 0; x < width; ++x)
+      packed_xtable[x] = makeRGB(t.xt[0][x], t.xt[1][x], t.xt[2][x]);
+    return &packed_xtable[0];
+  }
+
+  static inline unsigned char combineChannel(CombineOp op,
+                                             unsigned char a,
+                                             unsigned char b,
+                                             unsigned char to,
+                                             unsigned char mask,
+                                             bool darken) {
+    unsigned char v = (op == CombineSum) ? a + b
+                      : (op == CombineMax) ? 2 * std::max(a, b)
+                      : 2 * std::min(a, b);
+    v = (v ^ mask) - mask;
+    v += to;
+    if (darken)
+      v = (v >> 1) + (v >> 2);
+    return v;
+  }
 
-      xr += drx;
-      xg += dgx;
-      xb += dbx;
+  // handles the pixels left over at the end of a row
+  static void combineTail(CombineOp op, RGB *p, const RGB *xp,
+                          unsigned int count, const RGB &yy, const RGB &tt,
+                          const RGB &mm, bool darken) {
+    for (unsigned int x = 0; x < count; ++x, ++p, ++xp) {
+      *p = makeRGB(combineChannel(op, xp->red, yy.red,
+                                  tt.red, mm.red, darken),
+                   combineChannel(op, xp->green, yy.green,
+                                  tt.green, mm.green, darken),
+                   combineChannel(op, xp->blue, yy.blue,
+                                  tt.blue, mm.blue, darken));
     }
+  }
 
-    if (height > 1) {
-      // second line
-      memcpy(p, data, width * sizeof(RGB));
-      p += width;
+  static void ellipticTail(RGB *p, unsigned int x, unsigned int width,
+                           unsigned int y, const GradientTables &t,
+                           bool darken) {
+    for (; x < width; ++x, ++p) {
+      unsigned int c[3];
+      for (unsigned int i = 0; i < 3; ++i) {
+        c[i] = static_cast<unsigned char>
+               (t.to[i] - (t.sign[i] * static_cast<int>
+                           (sqrt(t.xt[i][x] + t.yt[i][y]))));
+        if (darken)
+          c[i] = (c[i] >> 1) + (c[i] >> 2);
+      }
+      *p = makeRGB(c[0], c[1], c[2]);
     }
   }
 
-  if (height > 2) {
-    // rest of the gradient
-    for (x = 0; x < total; ++x)
-      p[x] = data[x];
+  static inline RGB signMask(const GradientTables &t) {
+    return makeRGB(t.sign[0] > 0 ? 0xff : 0,
+                   t.sign[1] > 0 ? 0xff : 0,
+                   t.sign[2] > 0 ? 0xff : 0);
   }
-}
 
 
-void bt::Image::partial_vgradient(const Color &from, const Color &to, 
-                                  bool interlaced,
-                                  unsigned int fromHeight, 
-                                  unsigned int toHeight)
-{
-  double yr = static_cast<double>(from.red()  );
-  double yg = static_cast<double>(from.green());
-  double yb = static_cast<double>(from.blue() );
+#  ifdef __x86_64__
+#    define SSE2_TARGET
+#  else
+#    define SSE2_TARGET __attribute__((target("sse2")))
+#  endif
+#  define AVX2_TARGET __attribute__((target("avx2")))
 
-  double dry = static_cast<double>(to.red()   - from.red()  );
-  double dgy = static_cast<double>(to.green() - from.green());
-  double dby = static_cast<double>(to.blue()  - from.blue() );
+  SSE2_TARGET
+  static inline __m128i sse2Darken(__m128i v) {
+    return _mm_add_epi8(
+      _mm_and_si128(_mm_srli_epi32(v, 1), _mm_set1_epi8(0x7f)),
+      _mm_and_si128(_mm_srli_epi32(v, 2), _mm_set1_epi8(0x3f)));
+  }
 
-  unsigned int deltaHeight = toHeight - fromHeight;
-  dry /= deltaHeight;
-  dgy /= deltaHeight;
-  dby /= deltaHeight;
+  SSE2_TARGET
+  static void sse2Combine(CombineOp op, RGB *p,
+                          unsigned int width, unsigned int height,
+                          const GradientTables &t, bool interlaced) {
+    const RGB *xp = packXTable(t, width);
+    const RGB tt = makeRGB(t.to[0], t.to[1], t.to[2]);
+    const RGB mm = signMask(t);
+    const __m128i to = _mm_set1_epi32(packedRGB(tt));
+    const __m128i mask = _mm_set1_epi32(packedRGB(mm));
+
+    for (unsigned int y = 0; y < height; ++y, p += width) {
+      const RGB yy = makeRGB(t.yt[0][y], t.yt[1][y], t.yt[2][y]);
+      const __m128i yv = _mm_set1_epi32(packedRGB(yy));
+      const bool darken = interlaced && (y & 1);
+
+      unsigned int x = 0;
+      for (; x + 4 <= width; x += 4) {
+        const __m128i xv =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(xp + x));
+        __m128i v;
+        switch (op) {
+        case CombineSum:
+          v = _mm_add_epi8(xv, yv);
+          break;
+        case CombineMax:
+          v = _mm_max_epu8(xv, yv);
+          v = _mm_add_epi8(v, v);
+          break;
+        case CombineMin:
+        default:
+          v = _mm_min_epu8(xv, yv);
+          v = _mm_add_epi8(v, v);
+          break;
+        }
+        v = _mm_sub_epi8(_mm_xor_si128(v, mask), mask);
+        v = _mm_add_epi8(v, to);
+        if (darken)
+          v = sse2Darken(v);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + x), v);
+      }
+      combineTail(op, p + x, xp + x, width - x, yy, tt, mm, darken);
+    }
+  }
 
-  RGB *p = data + width*fromHeight;
-  unsigned int x, y;
+  SSE2_TARGET
+  static void sse2Sum(RGB *p, unsigned int width, unsigned int height,
+                          const GradientTables &t, bool interlaced)
+  { sse2Combine(CombineSum, p, width, height, t, interlaced); }
+
+  SSE2_TARGET
+  static void sse2Max(RGB *p, unsigned int width, unsigned int height,
+                            const GradientTables &t, bool interlaced)
+  { sse2Combine(CombineMax, p, width, height, t, interlaced); }
+
+  SSE2_TARGET
+  static void sse2Min(RGB *p, unsigned int width, unsigned int height,
+                            const GradientTables &t, bool interlaced)
+  { sse2Combine(CombineMin, p, width, height, t, interlaced); }
+
+  SSE2_TARGET
+  static inline __m128i sse2EllipticChannel(const unsigned int *xt,
+                                            unsigned int yt,
+                                            unsigned int to, int sign) {
+    const __m128i sum =
+      _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(xt)),
+                    _mm_set1_epi32(yt));
+    // the sums are below 2^24, so single precision sqrt truncates
+    // to the same integer as the double precision one
+    const __m128i root = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(sum)));
+    const __m128i v = (sign > 0)
+                      ? _mm_sub_epi32(_mm_set1_epi32(to), root)
+                      : _mm_add_epi32(_mm_set1_epi32(to), root);
+    return _mm_and_si128(v, _mm_set1_epi32(0xff));
+  }
+
+  SSE2_TARGET
+  static void sse2Elliptic(RGB *p, unsigned int width, unsigned int height,
+                           const GradientTables &t, bool interlaced) {
+    for (unsigned int y = 0; y < height; ++y, p += width) {
+      const bool darken = interlaced && (y & 1);
+
+      unsigned int x = 0;
+      for (; x + 4 <= width; x += 4) {
+        const __m128i r =
+          sse2EllipticChannel(t.xt[0] + x, t.yt[0][y], t.to[0], t.sign[0]);
+        const __m128i g =
+          sse2EllipticChannel(t.xt[1] + x, t.yt[1][y], t.to[1], t.sign[1]);
+        const __m128i b =
+          sse2EllipticChannel(t.xt[2] + x, t.yt[2][y], t.to[2], t.sign[2]);
+        __m128i v = _mm_or_si128(r, _mm_or_si128(_mm_slli_epi32(g, 8),
+                                                 _mm_slli_epi32(b, 16)));
+        if (darken)
+          v = sse2Darken(v);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + x), v);
+      }
+      ellipticTail(p + x, x, width, y, t, darken);
+    }
+  }
+
+  SSE2_TARGET
+  static void sse2Fill(RGB *p, const RGB &rgb, unsigned int count) {
+    const __m128i v = _mm_set1_epi32(packedRGB(rgb));
+    unsigned int x = 0;
+    for (; x + 4 <= count; x += 4)
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p + x), v);
+    for (; x < count; ++x)
+      p[x] = rgb;
+  }
 
 
-  if (interlaced) {
-    // faked interlacing effect
-    for (y = fromHeight; y < toHeight; ++y) {
-      const RGB rgb = {
-        static_cast<unsigned char>((y & 1) ? (yr * 3. / 4.) : yr),
-        static_cast<unsigned char>((y & 1) ? (yg * 3. / 4.) : yg),
-        static_cast<unsigned char>((y & 1) ? (yb * 3. / 4.) : yb),
-        0
-      };
-      for (x = 0; x < width; ++x, ++p)
-        *p = rgb;
-
-      yr += dry;
-      yg += dgy;
-      yb += dby;
+  AVX2_TARGET
+  static inline __m256i avx2Darken(__m256i v) {
+    return _mm256_add_epi8(
+      _mm256_and_si256(_mm256_srli_epi32(v, 1), _mm256_set1_epi8(0x7f)),
+      _mm256_and_si256(_mm256_srli_epi32(v, 2), _mm256_set1_epi8(0x3f)));
+  }
+
+  AVX2_TARGET
+  static void avx2Combine(CombineOp op, RGB *p,
+                          unsigned int width, unsigned int height,
+                          const GradientTables &t, bool interlaced) {
+    const RGB *xp = packXTable(t, width);
+    const RGB tt = makeRGB(t.to[0], t.to[1], t.to[2]);
+    const RGB mm = signMask(t);
+    const __m256i to = _mm256_set1_epi32(packedRGB(tt));
+    const __m256i mask = _mm256_set1_epi32(packedRGB(mm));
+
+    for (unsigned int y = 0; y < height; ++y, p += width) {
+      const RGB yy = makeRGB(t.yt[0][y], t.yt[1][y], t.yt[2][y]);
+      const __m256i yv = _mm256_set1_epi32(packedRGB(yy));
+      const bool darken = interlaced && (y & 1);
+
+      unsigned int x = 0;
+      for (; x + 8 <= width; x += 8) {
+        const __m256i xv =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(xp + x));
+        __m256i v;
+        switch (op) {
+        case CombineSum:
+          v = _mm256_add_epi8(xv, yv);
+          break;
+        case CombineMax:
+          v = _mm256_max_epu8(xv, yv);
+          v = _mm256_add_epi8(v, v);
+          break;
+        case CombineMin:
+        default:
+          v = _mm256_min_epu8(xv, yv);
+          v = _mm256_add_epi8(v, v);
+          break;
+        }
+        v = _mm256_sub_epi8(_mm256_xor_si256(v, mask), mask);
+        v = _mm256_add_epi8(v, to);
+        if (darken)
+          v = avx2Darken(v);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + x), v);
+      }
+      combineTail(op, p + x, xp + x, width - x, yy, tt, mm, darken);
     }
-  } else {
-    // normal vgradient
-      for (y = fromHeight; y < toHeight; ++y) {
-        const RGB rgb = {
-        static_cast<unsigned char>(yr),
-        static_cast<unsigned char>(yg),
-        static_cast<unsigned char>(yb),
-        0
-      };
-      for (x = 0; x < width; ++x, ++p)
-        *p = rgb;
-
-      yr += dry;
-      yg += dgy;
-      yb += dby;
+  }
+
+  AVX2_TARGET
+  static void avx2Sum(RGB *p, unsigned int width, unsigned int height,
+                          const GradientTables &t, bool interlaced)
+  { avx2Combine(CombineSum, p, width, height, t, interlaced); }
+
+  AVX2_TARGET
+  static void avx2Max(RGB *p, unsigned int width, unsigned int height,
+                            const GradientTables &t, bool interlaced)
+  { avx2Combine(CombineMax, p, width, height, t, interlaced); }
+
+  AVX2_TARGET
+  static void avx2Min(RGB *p, unsigned int width, unsigned int height,
+                            const GradientTables &t, bool interlaced)
+  { avx2Combine(CombineMin, p, width, height, t, interlaced); }
+
+  AVX2_TARGET
+  static inline __m256i avx2EllipticChannel(const unsigned int *xt,
+                                            unsigned int yt,
+                                            unsigned int to, int sign) {
+    const __m256i sum =
+      _mm256_add_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(xt)),
+        _mm256_set1_epi32(yt));
+    const __m256i root =
+      _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(sum)));
+    const __m256i v = (sign > 0)
+                      ? _mm256_sub_epi32(_mm256_set1_epi32(to), root)
+                      : _mm256_add_epi32(_mm256_set1_epi32(to), root);
+    return _mm256_and_si256(v, _mm256_set1_epi32(0xff));
+  }
+
+  AVX2_TARGET
+  static void avx2Elliptic(RGB *p, unsigned int width, unsigned int height,
+                           const GradientTables &t, bool interlaced) {
+    for (unsigned int y = 0; y < height; ++y, p += width) {
+      const bool darken = interlaced && (y & 1);
+
+      unsigned int x = 0;
+      for (; x + 8 <= width; x += 8) {
+        const __m256i r =
+          avx2EllipticChannel(t.xt[0] + x, t.yt[0][y], t.to[0], t.sign[0]);
+        const __m256i g =
+          avx2EllipticChannel(t.xt[1] + x, t.yt[1][y], t.to[1], t.sign[1]);
+        const __m256i b =
+          avx2EllipticChannel(t.xt[2] + x, t.yt[2][y], t.to[2], t.sign[2]);
+        __m256i v =
+          _mm256_or_si256(r, _mm256_or_si256(_mm256_slli_epi32(g, 8),
+                                             _mm256_slli_epi32(b, 16)));
+        if (darken)
+          v = avx2Darken(v);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + x), v);
+      }
+      ellipticTail(p + x, x, width, y, t, darken);
     }
   }
-}
 
+  AVX2_TARGET
+  static void avx2Fill(RGB *p, const RGB &rgb, unsigned int count) {
+    const __m256i v = _mm256_set1_epi32(packedRGB(rgb));
+    unsigned int x = 0;
+    for (; x + 8 <= count; x += 8)
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + x), v);
+    for (; x < count; ++x)
+      p[x] = rgb;
+  }
 
-void bt::Image::pgradient(const Color &from, const Color &to,
-                          bool interlaced) {
-  // pyramid gradient -  based on original dgradient, written by
-  // Mosfet (mosfet@kde.org)
-  // adapted from kde sources for Blackbox by Brad Hughes
 
-  double yr, yg, yb, drx, dgx, dbx, dry, dgy, dby, xr, xg, xb;
-  int rsign, gsign, bsign;
-  RGB *p = data;
-  unsigned int tr = to.red(), tg = to.green(), tb = to.blue();
-  unsigned int x, y;
+  static const RenderKernels sse2_kernels = {
+    "sse2",
+    sse2Sum,
+    sse2Sum,
+    sse2Max,
+    sse2Min,
+    sse2Elliptic,
+    sse2Fill
+  };
 
-  const unsigned int dimension = std::max(width, height);
-  unsigned int *alloc = new unsigned int[dimension * 6];
-  unsigned int *xt[3], *yt[3];
-  xt[0] = alloc + (dimension * 0);
-  xt[1] = alloc + (dimension * 1);
-  xt[2] = alloc + (dimension * 2);
-  yt[0] = alloc + (dimension * 3);
-  yt[1] = alloc + (dimension * 4);
-  yt[2] = alloc + (dimension * 5);
+  static const RenderKernels avx2_kernels = {
+    "avx2",
+    avx2Sum,
+    avx2Sum,
+    avx2Max,
+    avx2Min,
+    avx2Elliptic,
+    avx2Fill
+  };
+#endif // SIMD_X86
 
-  dry = drx = static_cast<double>(to.red()   - from.red());
-  dgy = dgx = static_cast<double>(to.green() - from.green());
-  dby = dbx = static_cast<double>(to.blue()  - from.blue());
 
-  rsign = (drx < 0) ? -1 : 1;
-  gsign = (dgx < 0) ? -1 : 1;
-  bsign = (dbx < 0) ? -1 : 1;
+  static const RenderKernels *render_kernels = &scalar_kernels;
 
-  xr = yr = (drx / 2);
-  xg = yg = (dgx / 2);
-  xb = yb = (dbx / 2);
 
-  // Create X table
-  drx /= width;
-  dgx /= width;
-  dbx /= width;
+  void selectRenderKernels(void) {
+    render_kernels = &scalar_kernels;
 
-  for (x = 0; x < width; ++x) {
-    xt[0][x] = static_cast<unsigned char>(fabs(xr));
-    xt[1][x] = static_cast<unsigned char>(fabs(xg));
-    xt[2][x] = static_cast<unsigned char>(fabs(xb));
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      render_kernels = &avx2_kernels;
+    else if (__builtin_cpu_supports("sse2"))
+      render_kernels = &sse2_kernels;
+#endif // SIMD_X86
 
-    xr -= drx;
-    xg -= dgx;
-    xb -= dbx;
+#ifdef DEBUG
+    fprintf(stderr, gettext("bt::Image: using %s gradient kernels\n"),
+            render_kernels->name);
+#endif // DEBUG
   }
 
-  // Create Y table
-  dry /= height;
-  dgy /= height;
-  dby /= height;
+} // namespace bt
 
-  for (y = 0; y < height; ++y) {
-    yt[0][y] = static_cast<unsigned char>(fabs(yr));
-    yt[1][y] = static_cast<unsigned char>(fabs(yg));
-    yt[2][y] = static_cast<unsigned char>(fabs(yb));
 
-    yr -= dry;
-    yg -= dgy;
-    yb -= dby;
+/*
+ * Gradient tables
+ *
+ * All gradients step their colors with a Ramp: a double precision
+ * accumulator that is truncated towards zero for each table entry or
+ * line.  The golden hashes in tests/gradients.cc pin down the output.
+ */
+namespace bt {
+
+  class Ramp {
+  public:
+    inline Ramp(double start, int delta, unsigned int steps)
+      : value(start), step(0.0)
+    {
+      if (steps > 0)
+        step = static_cast<double>(delta) / steps;
+    }
+
+    inline void advance(void)
+    { value += step; }
+
+    inline int level(void) const
+    { return static_cast<int>(value); }
+    // 3/4 of the current level, used for the interlacing effect
+    inline int darkLevel(void) const
+    { return static_cast<int>(value * 3. / 4.); }
+    inline int magnitude(void) const
+    { return static_cast<int>(fabs(value)); }
+    inline unsigned int square(void) const
+    { return static_cast<unsigned int>(value * value); }
+
+  private:
+    double value, step;
+  };
+
+  static void linearTable(unsigned int *table, unsigned int count,
+                          double start, int delta, unsigned int steps) {
+    Ramp ramp(start, delta, steps);
+    for (unsigned int i = 0; i < count; ++i, ramp.advance())
+      table[i] = static_cast<unsigned char>(ramp.level());
   }
 
-  // Combine tables to create gradient
+  static void magnitudeTable(unsigned int *table, unsigned int count,
+                             double start, int delta, unsigned int steps) {
+    Ramp ramp(start, delta, steps);
+    for (unsigned int i = 0; i < count; ++i, ramp.advance())
+      table[i] = static_cast<unsigned char>(ramp.magnitude());
+  }
 
-  if (!interlaced) {
-    // normal pgradient
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red =
-          static_cast<unsigned char>(tr - (rsign * (xt[0][x] + yt[0][y])));
-        p->green =
-          static_cast<unsigned char>(tg - (gsign * (xt[1][x] + yt[1][y])));
-        p->blue =
-          static_cast<unsigned char>(tb - (bsign * (xt[2][x] + yt[2][y])));
-      }
-    }
-  } else {
-    // interlacing effect
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red =
-          static_cast<unsigned char>(tr - (rsign * (xt[0][x] + yt[0][y])));
-        p->green =
-          static_cast<unsigned char>(tg - (gsign * (xt[1][x] + yt[1][y])));
-        p->blue =
-          static_cast<unsigned char>(tb - (bsign * (xt[2][x] + yt[2][y])));
-
-        if (y & 1) {
-          p->red   = (p->red   >> 1) + (p->red   >> 2);
-          p->green = (p->green >> 1) + (p->green >> 2);
-          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
-        }
-      }
-    }
+  static void squareTable(unsigned int *table, unsigned int count,
+                          double start, int delta, unsigned int steps) {
+    Ramp ramp(start, delta, steps);
+    for (unsigned int i = 0; i < count; ++i, ramp.advance())
+      table[i] = ramp.square();
   }
 
-  delete [] alloc;
-}
+} // namespace bt
 
 
-void bt::Image::rgradient(const Color &from, const Color &to,
+void bt::Image::dgradient(const Color &from, const Color &to,
                           bool interlaced) {
-  // rectangle gradient -  based on original dgradient, written by
-  // Mosfet (mosfet@kde.org)
-  // adapted from kde sources for Blackbox by Brad Hughes
+  // diagonal gradient code was written by Mike Cole <mike@mydot.com>
+  // modified for interlacing by Brad Hughes
 
-  double drx, dgx, dbx, dry, dgy, dby, xr, xg, xb, yr, yg, yb;
-  int rsign, gsign, bsign;
-  RGB *p = data;
-  unsigned int tr = to.red(), tg = to.green(), tb = to.blue();
-  unsigned int x, y;
+  const int f[3] = { from.red(), from.green(), from.blue() };
+  const int d[3] = { to.red()   - from.red(),
+                     to.green() - from.green(),
+                     to.blue()  - from.blue() };
 
   const unsigned int dimension = std::max(width, height);
-  unsigned int *alloc = new unsigned int[dimension * 6];
+  unsigned int *alloc = arena->tables.get(dimension * 6);
   unsigned int *xt[3], *yt[3];
   xt[0] = alloc + (dimension * 0);
   xt[1] = alloc + (dimension * 1);
@@ -1547,106 +2882,116 @@ void bt::Image::rgradient(const Color &from, const Color &to,
   yt[1] = alloc + (dimension * 4);
   yt[2] = alloc + (dimension * 5);
 
-  dry = drx = static_cast<double>(to.red()   - from.red());
-  dgy = dgx = static_cast<double>(to.green() - from.green());
-  dby = dbx = static_cast<double>(to.blue()  - from.blue());
-
-  rsign = (drx < 0) ? -2 : 2;
-  gsign = (dgx < 0) ? -2 : 2;
-  bsign = (dbx < 0) ? -2 : 2;
-
-  xr = yr = (drx / 2);
-  xg = yg = (dgx / 2);
-  xb = yb = (dbx / 2);
+  // Create X and Y tables
+  for (unsigned int c = 0; c < 3; ++c) {
+    linearTable(xt[c], width, f[c], d[c], width * 2);
+    linearTable(yt[c], height, 0, d[c], height * 2);
+  }
 
-  // Create X table
-  drx /= width;
-  dgx /= width;
-  dbx /= width;
+  // Combine tables to create gradient
+  const GradientTables tables = {
+    { xt[0], xt[1], xt[2] },
+    { yt[0], yt[1], yt[2] },
+    { 0u, 0u, 0u },
+    { -1, -1, -1 }
+  };
+  render_kernels->diagonal(data, width, height, tables, interlaced);
+}
 
-  for (x = 0; x < width; ++x) {
-    xt[0][x] = static_cast<unsigned char>(fabs(xr));
-    xt[1][x] = static_cast<unsigned char>(fabs(xg));
-    xt[2][x] = static_cast<unsigned char>(fabs(xb));
 
-    xr -= drx;
-    xg -= dgx;
-    xb -= dbx;
-  }
+void bt::Image::hgradient(const Color &from, const Color &to,
+                          bool interlaced) {
+  RGB *p = data;
+  unsigned int x;
 
-  // Create Y table
-  dry /= height;
-  dgy /= height;
-  dby /= height;
+  Ramp r(from.red(),   to.red()   - from.red(),   width);
+  Ramp g(from.green(), to.green() - from.green(), width);
+  Ramp b(from.blue(),  to.blue()  - from.blue(),  width);
 
-  for (y = 0; y < height; ++y) {
-    yt[0][y] = static_cast<unsigned char>(fabs(yr));
-    yt[1][y] = static_cast<unsigned char>(fabs(yg));
-    yt[2][y] = static_cast<unsigned char>(fabs(yb));
+  // first line
+  for (x = 0; x < width; ++x, ++p) {
+    p->red   = static_cast<unsigned char>(r.level());
+    p->green = static_cast<unsigned char>(g.level());
+    p->blue  = static_cast<unsigned char>(b.level());
 
-    yr -= dry;
-    yg -= dgy;
-    yb -= dby;
+    r.advance();
+    g.advance();
+    b.advance();
   }
 
-  // Combine tables to create gradient
+  if (height > 1) {
+    // second line
+    memcpy(p, data, width * sizeof(RGB));
 
-  if (!interlaced) {
-    // normal rgradient
-    for (y = 0; y < height; ++y) {
+    if (interlaced) {
+      // interlacing effect
       for (x = 0; x < width; ++x, ++p) {
-        p->red =
-          static_cast<unsigned char>(tr - (rsign *
-                                           std::max(xt[0][x], yt[0][y])));
-        p->green =
-          static_cast<unsigned char>(tg - (gsign *
-                                           std::max(xt[1][x], yt[1][y])));
-        p->blue =
-          static_cast<unsigned char>(tb - (bsign *
-                                           std::max(xt[2][x], yt[2][y])));
+        p->red   = (p->red   >> 1) + (p->red   >> 2);
+        p->green = (p->green >> 1) + (p->green >> 2);
+        p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
       }
+    } else {
+      p += width;
     }
-  } else {
-    // interlacing effect
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red =
-          static_cast<unsigned char>(tr - (rsign *
-                                           std::max(xt[0][x], yt[0][y])));
-        p->green =
-          static_cast<unsigned char>(tg - (gsign *
-                                           std::max(xt[1][x], yt[1][y])));
-        p->blue =
-          static_cast<unsigned char>(tb - (bsign *
-                                           std::max(xt[2][x], yt[2][y])));
-
-        if (y & 1) {
-          p->red   = (p->red   >> 1) + (p->red   >> 2);
-          p->green = (p->green >> 1) + (p->green >> 2);
-          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
-        }
-      }
+  }
+
+  if (height > 2) {
+    // rest of the gradient, copying the first two lines in
+    // doubling chunks
+    unsigned int done = width * 2;
+    while (done < width * height) {
+      const unsigned int count = std::min(done, width * height - done);
+      memcpy(data + done, data, count * sizeof(RGB));
+      done += count;
     }
   }
+}
+
+
+void bt::Image::partial_vgradient(const Color &from, const Color &to,
+                                  bool interlaced,
+                                  unsigned int fromHeight,
+                                  unsigned int toHeight)
+{
+  const unsigned int deltaHeight = toHeight - fromHeight;
+  Ramp r(from.red(),   to.red()   - from.red(),   deltaHeight);
+  Ramp g(from.green(), to.green() - from.green(), deltaHeight);
+  Ramp b(from.blue(),  to.blue()  - from.blue(),  deltaHeight);
+
+  RGB *p = data + width*fromHeight;
+  unsigned int y;
 
-  delete [] alloc;
+  for (y = fromHeight; y < toHeight; ++y) {
+    // faked interlacing effect
+    const bool dark = interlaced && (y & 1);
+    const RGB rgb = {
+      static_cast<unsigned char>(dark ? r.darkLevel() : r.level()),
+      static_cast<unsigned char>(dark ? g.darkLevel() : g.level()),
+      static_cast<unsigned char>(dark ? b.darkLevel() : b.level()),
+      0
+    };
+    render_kernels->fill(p, rgb, width);
+    p += width;
+
+    r.advance();
+    g.advance();
+    b.advance();
+  }
 }
 
 
-void bt::Image::egradient(const Color &from, const Color &to,
+void bt::Image::pgradient(const Color &from, const Color &to,
                           bool interlaced) {
-  // elliptic gradient -  based on original dgradient, written by
+  // pyramid gradient -  based on original dgradient, written by
   // Mosfet (mosfet@kde.org)
   // adapted from kde sources for Blackbox by Brad Hughes
 
-  double drx, dgx, dbx, dry, dgy, dby, yr, yg, yb, xr, xg, xb;
-  int rsign, gsign, bsign;
-  RGB *p = data;
-  unsigned int tr = to.red(), tg = to.green(), tb = to.blue();
-  unsigned int x, y;
+  const int d[3] = { to.red()   - from.red(),
+                     to.green() - from.green(),
+                     to.blue()  - from.blue() };
 
   const unsigned int dimension = std::max(width, height);
-  unsigned int *alloc = new unsigned int[dimension * 6];
+  unsigned int *alloc = arena->tables.get(dimension * 6);
   unsigned int *xt[3], *yt[3];
   xt[0] = alloc + (dimension * 0);
   xt[1] = alloc + (dimension * 1);
@@ -1655,89 +3000,101 @@ void bt::Image::egradient(const Color &from, const Color &to,
   yt[1] = alloc + (dimension * 4);
   yt[2] = alloc + (dimension * 5);
 
-  dry = drx = static_cast<double>(to.red() - from.red());
-  dgy = dgx = static_cast<double>(to.green() - from.green());
-  dby = dbx = static_cast<double>(to.blue() - from.blue());
+  // Create X and Y tables, from half the color difference down to
+  // minus half
+  for (unsigned int c = 0; c < 3; ++c) {
+    magnitudeTable(xt[c], width, d[c] / 2.0, -d[c], width);
+    magnitudeTable(yt[c], height, d[c] / 2.0, -d[c], height);
+  }
 
-  rsign = (drx < 0) ? -1 : 1;
-  gsign = (dgx < 0) ? -1 : 1;
-  bsign = (dbx < 0) ? -1 : 1;
+  // Combine tables to create gradient
+  const GradientTables tables = {
+    { xt[0], xt[1], xt[2] },
+    { yt[0], yt[1], yt[2] },
+    { static_cast<unsigned int>(to.red()),
+      static_cast<unsigned int>(to.green()),
+      static_cast<unsigned int>(to.blue()) },
+    { (d[0] < 0) ? -1 : 1, (d[1] < 0) ? -1 : 1, (d[2] < 0) ? -1 : 1 }
+  };
+  render_kernels->pyramid(data, width, height, tables, interlaced);
+}
 
-  xr = yr = (drx / 2);
-  xg = yg = (dgx / 2);
-  xb = yb = (dbx / 2);
 
-  // Create X table
-  drx /= width;
-  dgx /= width;
-  dbx /= width;
+void bt::Image::rgradient(const Color &from, const Color &to,
+                          bool interlaced) {
+  // rectangle gradient -  based on original dgradient, written by
+  // Mosfet (mosfet@kde.org)
+  // adapted from kde sources for Blackbox by Brad Hughes
 
-  for (x = 0; x < width; x++) {
-    xt[0][x] = static_cast<unsigned int>(xr * xr);
-    xt[1][x] = static_cast<unsigned int>(xg * xg);
-    xt[2][x] = static_cast<unsigned int>(xb * xb);
+  const int d[3] = { to.red()   - from.red(),
+                     to.green() - from.green(),
+                     to.blue()  - from.blue() };
 
-    xr -= drx;
-    xg -= dgx;
-    xb -= dbx;
+  const unsigned int dimension = std::max(width, height);
+  unsigned int *alloc = arena->tables.get(dimension * 6);
+  unsigned int *xt[3], *yt[3];
+  xt[0] = alloc + (dimension * 0);
+  xt[1] = alloc + (dimension * 1);
+  xt[2] = alloc + (dimension * 2);
+  yt[0] = alloc + (dimension * 3);
+  yt[1] = alloc + (dimension * 4);
+  yt[2] = alloc + (dimension * 5);
+
+  // Create X and Y tables
+  for (unsigned int c = 0; c < 3; ++c) {
+    magnitudeTable(xt[c], width, d[c] / 2.0, -d[c], width);
+    magnitudeTable(yt[c], height, d[c] / 2.0, -d[c], height);
   }
 
-  // Create Y table
-  dry /= height;
-  dgy /= height;
-  dby /= height;
+  // Combine tables to create gradient
+  const GradientTables tables = {
+    { xt[0], xt[1], xt[2] },
+    { yt[0], yt[1], yt[2] },
+    { static_cast<unsigned int>(to.red()),
+      static_cast<unsigned int>(to.green()),
+      static_cast<unsigned int>(to.blue()) },
+    { (d[0] < 0) ? -2 : 2, (d[1] < 0) ? -2 : 2, (d[2] < 0) ? -2 : 2 }
+  };
+  render_kernels->rectangle(data, width, height, tables, interlaced);
+}
 
-  for (y = 0; y < height; y++) {
-    yt[0][y] = static_cast<unsigned int>(yr * yr);
-    yt[1][y] = static_cast<unsigned int>(yg * yg);
-    yt[2][y] = static_cast<unsigned int>(yb * yb);
 
-    yr -= dry;
-    yg -= dgy;
-    yb -= dby;
-  }
+void bt::Image::egradient(const Color &from, const Color &to,
+                          bool interlaced) {
+  // elliptic gradient -  based on original dgradient, written by
+  // Mosfet (mosfet@kde.org)
+  // adapted from kde sources for Blackbox by Brad Hughes
 
-  // Combine tables to create gradient
+  const int d[3] = { to.red()   - from.red(),
+                     to.green() - from.green(),
+                     to.blue()  - from.blue() };
 
-  if (!interlaced) {
-    // normal egradient
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red   = static_cast<unsigned char>
-                   (tr - (rsign * static_cast<int>(sqrt(xt[0][x] +
-                                                        yt[0][y]))));
-        p->green = static_cast<unsigned char>
-                   (tg - (gsign * static_cast<int>(sqrt(xt[1][x] +
-                                                        yt[1][y]))));
-        p->blue  = static_cast<unsigned char>
-                   (tb - (bsign * static_cast<int>(sqrt(xt[2][x] +
-                                                        yt[2][y]))));
-      }
-    }
-  } else {
-    // interlacing effect
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red   = static_cast<unsigned char>
-                   (tr - (rsign * static_cast<int>(sqrt(xt[0][x]
-                                                        + yt[0][y]))));
-        p->green = static_cast<unsigned char>
-                   (tg - (gsign * static_cast<int>(sqrt(xt[1][x]
-                                                        + yt[1][y]))));
-        p->blue  = static_cast<unsigned char>
-                   (tb - (bsign * static_cast<int>(sqrt(xt[2][x]
-                                                        + yt[2][y]))));
+  const unsigned int dimension = std::max(width, height);
+  unsigned int *alloc = arena->tables.get(dimension * 6);
+  unsigned int *xt[3], *yt[3];
+  xt[0] = alloc + (dimension * 0);
+  xt[1] = alloc + (dimension * 1);
+  xt[2] = alloc + (dimension * 2);
+  yt[0] = alloc + (dimension * 3);
+  yt[1] = alloc + (dimension * 4);
+  yt[2] = alloc + (dimension * 5);
 
-        if (y & 1) {
-          p->red   = (p->red   >> 1) + (p->red   >> 2);
-          p->green = (p->green >> 1) + (p->green >> 2);
-          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
-        }
-      }
-    }
+  // Create X and Y tables
+  for (unsigned int c = 0; c < 3; ++c) {
+    squareTable(xt[c], width, d[c] / 2.0, -d[c], width);
+    squareTable(yt[c], height, d[c] / 2.0, -d[c], height);
   }
 
-  delete [] alloc;
+  // Combine tables to create gradient
+  const GradientTables tables = {
+    { xt[0], xt[1], xt[2] },
+    { yt[0], yt[1], yt[2] },
+    { static_cast<unsigned int>(to.red()),
+      static_cast<unsigned int>(to.green()),
+      static_cast<unsigned int>(to.blue()) },
+    { (d[0] < 0) ? -1 : 1, (d[1] < 0) ? -1 : 1, (d[2] < 0) ? -1 : 1 }
+  };
+  render_kernels->elliptic(data, width, height, tables, interlaced);
 }
 
 
@@ -1747,14 +3104,12 @@ void bt::Image::pcgradient(const Color &from, const Color &to,
   // Mosfet (mosfet@kde.org)
   // adapted from kde sources for Blackbox by Brad Hughes
 
-  double drx, dgx, dbx, dry, dgy, dby, xr, xg, xb, yr, yg, yb;
-  int rsign, gsign, bsign;
-  RGB *p = data;
-  unsigned int tr = to.red(), tg = to.green(), tb = to.blue();
-  unsigned int x, y;
+  const int d[3] = { to.red()   - from.red(),
+                     to.green() - from.green(),
+                     to.blue()  - from.blue() };
 
   const unsigned int dimension = std::max(width, height);
-  unsigned int *alloc = new unsigned int[dimension * 6];
+  unsigned int *alloc = arena->tables.get(dimension * 6);
   unsigned int *xt[3], *yt[3];
   xt[0] = alloc + (dimension * 0);
   xt[1] = alloc + (dimension * 1);
@@ -1763,89 +3118,22 @@ void bt::Image::pcgradient(const Color &from, const Color &to,
   yt[1] = alloc + (dimension * 4);
   yt[2] = alloc + (dimension * 5);
 
-  dry = drx = static_cast<double>(to.red()   - from.red());
-  dgy = dgx = static_cast<double>(to.green() - from.green());
-  dby = dbx = static_cast<double>(to.blue()  - from.blue());
-
-  rsign = (drx < 0) ? -2 : 2;
-  gsign = (dgx < 0) ? -2 : 2;
-  bsign = (dbx < 0) ? -2 : 2;
-
-  xr = yr = (drx / 2);
-  xg = yg = (dgx / 2);
-  xb = yb = (dbx / 2);
-
-  // Create X table
-  drx /= width;
-  dgx /= width;
-  dbx /= width;
-
-  for (x = 0; x < width; ++x) {
-    xt[0][x] = static_cast<unsigned char>(fabs(xr));
-    xt[1][x] = static_cast<unsigned char>(fabs(xg));
-    xt[2][x] = static_cast<unsigned char>(fabs(xb));
-
-    xr -= drx;
-    xg -= dgx;
-    xb -= dbx;
-  }
-
-  // Create Y table
-  dry /= height;
-  dgy /= height;
-  dby /= height;
-
-  for (y = 0; y < height; ++y) {
-    yt[0][y] = static_cast<unsigned char>(fabs(yr));
-    yt[1][y] = static_cast<unsigned char>(fabs(yg));
-    yt[2][y] = static_cast<unsigned char>(fabs(yb));
-
-    yr -= dry;
-    yg -= dgy;
-    yb -= dby;
+  // Create X and Y tables
+  for (unsigned int c = 0; c < 3; ++c) {
+    magnitudeTable(xt[c], width, d[c] / 2.0, -d[c], width);
+    magnitudeTable(yt[c], height, d[c] / 2.0, -d[c], height);
   }
 
   // Combine tables to create gradient
-
-  if (!interlaced) {
-    // normal rgradient
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red =
-          static_cast<unsigned char>(tr - (rsign *
-                                           std::min(xt[0][x], yt[0][y])));
-        p->green =
-          static_cast<unsigned char>(tg - (gsign *
-                                           std::min(xt[1][x], yt[1][y])));
-        p->blue =
-          static_cast<unsigned char>(tb - (bsign *
-                                           std::min(xt[2][x], yt[2][y])));
-      }
-    }
-  } else {
-    // interlacing effect
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red =
-          static_cast<unsigned char>(tr - (rsign *
-                                           std::min(xt[0][x], yt[0][y])));
-        p->green =
-          static_cast<unsigned char>(tg - (gsign *
-                                           std::min(xt[1][x], yt[1][y])));
-        p->blue =
-          static_cast<unsigned char>(tb - (bsign *
-                                           std::min(xt[2][x], yt[2][y])));
-
-        if (y & 1) {
-          p->red   = (p->red   >> 1) + (p->red   >> 2);
-          p->green = (p->green >> 1) + (p->green >> 2);
-          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
-        }
-      }
-    }
-  }
-
-  delete [] alloc;
+  const GradientTables tables = {
+    { xt[0], xt[1], xt[2] },
+    { yt[0], yt[1], yt[2] },
+    { static_cast<unsigned int>(to.red()),
+      static_cast<unsigned int>(to.green()),
+      static_cast<unsigned int>(to.blue()) },
+    { (d[0] < 0) ? -2 : 2, (d[1] < 0) ? -2 : 2, (d[2] < 0) ? -2 : 2 }
+  };
+  render_kernels->pipecross(data, width, height, tables, interlaced);
 }
 
 
@@ -1855,17 +3143,13 @@ void bt::Image::cdgradient(const Color &from, const Color &to,
   // Mosfet (mosfet@kde.org)
   // adapted from kde sources for Blackbox by Brad Hughes
 
-  double drx, dgx, dbx, dry, dgy, dby;
-  double yr = 0.0, yg = 0.0, yb = 0.0,
-         xr = static_cast<double>(from.red()  ),
-         xg = static_cast<double>(from.green()),
-         xb = static_cast<double>(from.blue() );
-  RGB *p = data;
-  unsigned int w = width * 2, h = height * 2;
-  unsigned int x, y;
+  const int f[3] = { from.red(), from.green(), from.blue() };
+  const int d[3] = { to.red()   - from.red(),
+                     to.green() - from.green(),
+                     to.blue()  - from.blue() };
 
   const unsigned int dimension = std::max(width, height);
-  unsigned int *alloc = new unsigned int[dimension * 6];
+  unsigned int *alloc = arena->tables.get(dimension * 6);
   unsigned int *xt[3], *yt[3];
   xt[0] = alloc + (dimension * 0);
   xt[1] = alloc + (dimension * 1);
@@ -1874,73 +3158,21 @@ void bt::Image::cdgradient(const Color &from, const Color &to,
   yt[1] = alloc + (dimension * 4);
   yt[2] = alloc + (dimension * 5);
 
-  dry = drx = static_cast<double>(to.red()   - from.red()  );
-  dgy = dgx = static_cast<double>(to.green() - from.green());
-  dby = dbx = static_cast<double>(to.blue()  - from.blue() );
-
-  // Create X table
-  drx /= w;
-  dgx /= w;
-  dbx /= w;
-
-  for (x = width - 1; x != 0; --x) {
-    xt[0][x] = static_cast<unsigned char>(xr);
-    xt[1][x] = static_cast<unsigned char>(xg);
-    xt[2][x] = static_cast<unsigned char>(xb);
-
-    xr += drx;
-    xg += dgx;
-    xb += dbx;
-  }
-
-  xt[0][x] = static_cast<unsigned char>(xr);
-  xt[1][x] = static_cast<unsigned char>(xg);
-  xt[2][x] = static_cast<unsigned char>(xb);
-
-  // Create Y table
-  dry /= h;
-  dgy /= h;
-  dby /= h;
-
-  for (y = 0; y < height; ++y) {
-    yt[0][y] = static_cast<unsigned char>(yr);
-    yt[1][y] = static_cast<unsigned char>(yg);
-    yt[2][y] = static_cast<unsigned char>(yb);
-
-    yr += dry;
-    yg += dgy;
-    yb += dby;
+  // Create X and Y tables, the X table runs from right to left
+  for (unsigned int c = 0; c < 3; ++c) {
+    linearTable(xt[c], width, f[c], d[c], width * 2);
+    std::reverse(xt[c], xt[c] + width);
+    linearTable(yt[c], height, 0, d[c], height * 2);
   }
 
   // Combine tables to create gradient
-
-  if (!interlaced) {
-    // normal dgradient
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red   = xt[0][x] + yt[0][y];
-        p->green = xt[1][x] + yt[1][y];
-        p->blue  = xt[2][x] + yt[2][y];
-      }
-    }
-  } else {
-    // interlacing effect
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x, ++p) {
-        p->red   = xt[0][x] + yt[0][y];
-        p->green = xt[1][x] + yt[1][y];
-        p->blue  = xt[2][x] + yt[2][y];
-
-        if (y & 1) {
-          p->red   = (p->red   >> 1) + (p->red   >> 2);
-          p->green = (p->green >> 1) + (p->green >> 2);
-          p->blue  = (p->blue  >> 1) + (p->blue  >> 2);
-        }
-      }
-    }
-  }
-
-  delete [] alloc;
+  const GradientTables tables = {
+    { xt[0], xt[1], xt[2] },
+    { yt[0], yt[1], yt[2] },
+    { 0u, 0u, 0u },
+    { -1, -1, -1 }
+  };
+  render_kernels->diagonal(data, width, height, tables, interlaced);
 }
 
 
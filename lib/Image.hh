@@ -32,6 +32,8 @@ namespace bt {
   // forward declarations
   class Color;
   class Display;
+  class RenderArena;
+  struct RenderCacheHeader;
   class ScreenInfo;
   class Texture;
   class XColorTable;
@@ -61,6 +63,52 @@ namespace bt {
     static inline void setDitherMode(DitherMode dithermode)
     { global_ditherMode = dithermode; }
 
+    /*
+      Returns the number of times the render buffers had to allocate
+      memory.  Rendering textures of sizes seen before should not
+      increase this.
+    */
+    static unsigned long bufferAllocations(void);
+
+    /*
+      Shrinks the render buffers back to what the renders since the
+      last call needed.  bt::Application calls this when it has no
+      events to process and nothing left to render.
+    */
+    static void trimRenderBuffers(void);
+
+    /*
+      Returns true if images rendered for the specified screen are
+      dithered.  A dithered image depends on the position of each
+      pixel, not just on the texture.
+    */
+    static bool isDithered(const Display &display, unsigned int screen);
+
+    /*
+      Enables or disables the on-disk render cache, which keeps large
+      software rendered images under XDG::BaseDir::cacheHome() across
+      restarts.  The stamp should identify what the textures come from
+      (e.g. the style file and its modification time); the cache is
+      emptied whenever it changes.  The directory is kept below 32 MB
+      by removing the oldest images.  Disabled by default.
+    */
+    static void setRenderCache(bool enabled, const std::string &stamp);
+
+    /*
+      Writes one image rendered since the render cache was enabled to
+      disk.  Returns true if more are waiting.  bt::Application calls
+      this when it has no events to process, so rendering never waits
+      for the disk.
+    */
+    static bool writeRenderCache(void);
+
+    /*
+      Marks the start and the end of an interactive resize.  Images
+      rendered meanwhile are not written to the render cache until it
+      ends, and then only the last size rendered for each texture.
+    */
+    static void setInteractiveResize(bool resizing);
+
     Image(unsigned int w, unsigned int h);
     ~Image(void);
 
@@ -70,6 +118,7 @@ namespace bt {
   private:
     RGB *data;
     unsigned int width, height;
+    RenderArena *arena;
 
     void OrderedDither(XColorTable *colortable,
                        unsigned int bit_depth,
@@ -80,7 +129,10 @@ namespace bt {
                               unsigned int bytes_per_line,
                               unsigned char *pixel_data);
 
-    Pixmap renderPixmap(const Display &display, unsigned int screen);
+    Pixmap renderSoftware(const Display &display, unsigned int screen,
+                          const Texture &texture);
+    Pixmap renderPixmap(const Display &display, unsigned int screen,
+                        const RenderCacheHeader *cache_header);
 
     void raisedBevel(unsigned int border_width = 0);
     void sunkenBevel(unsigned int border_width = 0);
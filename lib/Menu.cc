@@ -166,7 +166,7 @@ unsigned int bt::MenuStyle::itemMargin(void) const {
 }
 
 
-bt::Rect bt::MenuStyle::titleRect(const ustring &text) const {
+bt::Rect bt::MenuStyle::titleRect(const InternedString &text) const {
   const Rect &rect = textRect(_screen, title.font, text);
   return Rect(0, 0,
               rect.width()  + (titleMargin() * 2),
@@ -183,7 +183,7 @@ bt::Rect bt::MenuStyle::itemRect(const MenuItem &item) const {
 
 
 void bt::MenuStyle::drawTitle(Window window, const Rect &rect,
-                              const ustring &text) const {
+                              const InternedString &text) const {
   Pen pen(_screen, title.text);
   Rect r;
   r.setCoords(rect.left() + titleMargin(), rect.top(),
@@ -418,7 +418,7 @@ bt::Menu::ItemList::iterator bt::Menu::findItem(unsigned int id, Rect& r) {
 }
 
 
-void bt::Menu::changeItem(unsigned int id, const ustring &newlabel,
+void bt::Menu::changeItem(unsigned int id, const InternedString &newlabel,
                           unsigned int newid) {
   Rect r(_irect.x(), _irect.y(), _itemw, 0);
   ItemList::iterator it = findItem(id, r);
@@ -687,6 +687,30 @@ void bt::Menu::reconfigure(void) {
 }
 
 
+void bt::Menu::prewarm(void) {
+  if (_size_dirty)
+    updateSize();
+
+  MenuStyle* style = MenuStyle::get(_app, _screen);
+  if (_show_title) {
+    PixmapCache::prewarm(_screen, style->titleTexture(),
+                         _trect.width(), _trect.height());
+  }
+  PixmapCache::prewarm(_screen, style->frameTexture(),
+                       _frect.width(), _frect.height());
+  PixmapCache::prewarm(_screen, style->activeTexture(), _itemw,
+                       textHeight(_screen, style->frameFont()) +
+                       (style->itemMargin() * 2));
+
+  const ItemList::iterator &end = _items.end();
+  ItemList::iterator it;
+  for (it = _items.begin(); it != end; ++it) {
+    if (it->sub)
+      it->sub->prewarm();
+  }
+}
+
+
 void bt::Menu::updateSize(void) {
   MenuStyle* style = MenuStyle::get(_app, _screen);
 
@@ -45,12 +45,12 @@ namespace bt {
   {
   public:
     enum Type { Normal, Separator };
-    inline MenuItem(Type t, const ustring &l = ustring())
+    inline MenuItem(Type t, const InternedString &l = InternedString())
       : sub(0), lbl(l), ident(~0u), indx(~0u), height(0),
         separator(t == Separator),
         active(0), title(0), enabled(1), checked(0)
     { }
-    inline MenuItem(Menu *s, const ustring &l)
+    inline MenuItem(Menu *s, const InternedString &l)
       : sub(s), lbl(l), ident(~0u), indx(~0u), height(0), separator(0),
         active(0), title(0), enabled(1), checked(0)
     { }
@@ -74,12 +74,12 @@ namespace bt {
     inline Menu *submenu(void) const
     { return sub; }
 
-    inline const ustring &label(void) const
+    inline const InternedString &label(void) const
     { return lbl; }
 
   private:
     Menu *sub;
-    ustring lbl;
+    InternedString lbl;
     unsigned int ident;
     unsigned int indx;
     unsigned int height;
@@ -133,12 +133,12 @@ namespace bt {
     { return frame.font; }
 
     // size calculations
-    Rect titleRect(const ustring &text) const;
+    Rect titleRect(const InternedString &text) const;
     Rect itemRect(const MenuItem &item) const;
 
     // drawing
     void drawTitle(Window window, const Rect &rect,
-                   const ustring &text) const;
+                   const InternedString &text) const;
     void drawItem(Window window, const Rect &rect,
                   const MenuItem &item, Pixmap activePixmap) const;
 
@@ -187,12 +187,12 @@ namespace bt {
                             unsigned int id = ~0u,
                             unsigned int index = ~0u);
 
-    inline unsigned int insertItem(const ustring &label,
+    inline unsigned int insertItem(const InternedString &label,
                                    unsigned int id = ~0u,
                                    unsigned int index = ~0u)
     { return insertItem(MenuItem(MenuItem::Normal, label), id, index); }
 
-    inline unsigned int insertItem(const ustring &label,
+    inline unsigned int insertItem(const InternedString &label,
                                    Menu *submenu,
                                    unsigned int id = ~0u,
                                    unsigned int index = ~0u)
@@ -203,7 +203,7 @@ namespace bt {
 
 
     void changeItem(unsigned int id,
-                    const ustring &newlabel,
+                    const InternedString &newlabel,
                     unsigned int newid = ~0u);
 
     void setItemEnabled(unsigned int id, bool enabled);
@@ -219,9 +219,9 @@ namespace bt {
     inline unsigned int count(void) const
     { return _items.size(); }
 
-    inline const ustring &title(void) const
+    inline const InternedString &title(void) const
     { return _title; }
-    inline void setTitle(const ustring &newtitle)
+    inline void setTitle(const InternedString &newtitle)
     { _title = newtitle; }
     void showTitle(void);
     void hideTitle(void);
@@ -241,6 +241,13 @@ namespace bt {
     virtual void refresh(void);
     virtual void reconfigure(void);
 
+    /*
+      Schedules the pixmaps for this menu and its submenus to be
+      rendered while idle (see PixmapCache::prewarm()), so that
+      showing the menu the first time does not have to render them.
+    */
+    void prewarm(void);
+
     inline bool autoDelete(void) const
     { return _auto_delete; }
     inline void setAutoDelete(bool ad)
@@ -296,7 +303,7 @@ namespace bt {
     Rect _irect; // items inside the frame
 
     Timer _timer;
-    ustring _title;
+    InternedString _title;
 
     ItemList _items;
     std::vector<bool> _id_bits;
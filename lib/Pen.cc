@@ -22,12 +22,16 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 // DEALINGS IN THE SOFTWARE.
 
+#include "gettext.h"
 #include "Pen.hh"
 #include "Display.hh"
 #include "Color.hh"
 #include "Util.hh"
 
 #include <algorithm>
+#include <list>
+#include <map>
+#include <vector>
 
 #include <X11/Xlib.h>
 #ifdef XFT
@@ -37,57 +41,302 @@
 #include <assert.h>
 #include <cstdio>
 
+// #define PENCACHE_DEBUG
+
 namespace bt {
 
-  class PenLoader
-  {
-    const Display &_display;
-  public:
-    PenLoader(const Display &display_)
-      : _display(display_)
+  /*
+    The GCs used by Pens.  GCs are shared by all Pens with the same
+    state, reference counted and kept around for a while after the
+    last Pen using them goes away, so that redrawing reuses existing
+    GCs instead of creating and freeing one for every Pen.
+  */
+  struct PenCacheItem;
+
+  struct PenCacheKey {
+    unsigned long pixel;
+    int function;
+    int linewidth;
+    int subwindow;
+    bool tiled;
+
+    inline bool operator<(const PenCacheKey &k) const {
+      if (pixel != k.pixel)
+        return pixel < k.pixel;
+      if (function != k.function)
+        return function < k.function;
+      if (linewidth != k.linewidth)
+        return linewidth < k.linewidth;
+      if (subwindow != k.subwindow)
+        return subwindow < k.subwindow;
+      return tiled < k.tiled;
+    }
+  };
+
+  typedef std::list<PenCacheItem *> PenCacheItemList;
+  typedef std::multimap<PenCacheKey, PenCacheItem *> PenCacheItemMap;
+
+  struct PenCacheItem {
+    const unsigned int screen;
+    GC gc;
+    unsigned int count;
+    PenCacheItemMap::iterator entry;
+    PenCacheItemList::iterator lru; // in unused, while count == 0
+
+    inline PenCacheItem(unsigned int s, GC g)
+      : screen(s), gc(g), count(0u)
     { }
+  };
+
+  class PenCache {
+  public:
+    // the unused GCs kept per screen
+    enum { UnusedLimit = 32 };
+
+    typedef PenCacheKey Key;
+    typedef PenCacheItem Item;
+    typedef PenCacheItemList ItemList;
+    typedef PenCacheItemMap ItemMap;
+
+    PenCache(const Display &display_);
+    ~PenCache(void);
+
     const Display &display(void) const
     { return _display; }
     ::Display *XDisplay(void) const
     { return _display.XDisplay(); }
+
+    Item *find(unsigned int screen, const Key &key,
+               Pixmap tile, int tile_x, int tile_y);
+    void release(Item *item);
+
+    XftDraw *xftDraw(unsigned int screen, Drawable drawable);
+    void releaseDrawable(Drawable drawable);
+
+  private:
+    struct ScreenCache {
+      ItemMap items;
+      ItemList unused; // most recently used first
+      Pixmap blank; // the tile of unused tiled GCs
+
+      inline ScreenCache(void)
+        : blank(0ul)
+      { }
+    };
+
+    ScreenCache &screenCache(unsigned int screen)
+    { return screens[screens.size() == 1 ? 0 : screen]; }
+
+    void remove(Item *item);
+
+    const Display &_display;
+    std::vector<ScreenCache> screens;
+
+    // one XftDraw per drawable, shared by all Pens
+    typedef std::map<Drawable, XftDraw *> XftDrawMap;
+    XftDrawMap xftdraws;
   };
 
-  static PenLoader *penloader = 0;
+  static PenCache *pencache = 0;
 
-  void createPenLoader(const Display &display)
+  void createPenCache(const Display &display)
   {
-    assert(penloader == 0);
-    penloader = new PenLoader(display);
+    assert(pencache == 0);
+    pencache = new PenCache(display);
   }
-  void destroyPenLoader(void)
+  void destroyPenCache(void)
   {
-    delete penloader;
-    penloader = 0;
+    delete pencache;
+    pencache = 0;
   }
 
 } // namespace bt
 
+
+bt::PenCache::PenCache(const Display &display_)
+  : _display(display_), screens(display_.screenCount())
+{ }
+
+
+bt::PenCache::~PenCache(void)
+{
+  for (unsigned int i = 0; i < screens.size(); ++i) {
+    ItemMap &items = screens[i].items;
+    for (ItemMap::iterator it = items.begin(); it != items.end(); ++it) {
+      XFreeGC(XDisplay(), it->second->gc);
+      delete it->second;
+    }
+    if (screens[i].blank)
+      XFreePixmap(XDisplay(), screens[i].blank);
+  }
+
+  while (!xftdraws.empty())
+    releaseDrawable(xftdraws.begin()->first);
+}
+
+
+/*
+  Returns a GC for the key, with a reference.  A tiled GC is not
+  shared, since the tile and origin are set by its user, but unused
+  ones are still reused.
+*/
+bt::PenCache::Item *bt::PenCache::find(unsigned int screen, const Key &key,
+                                       Pixmap tile, int tile_x, int tile_y)
+{
+  ScreenCache &cache = screenCache(screen);
+
+  Item *item = 0;
+  std::pair<ItemMap::iterator, ItemMap::iterator> range =
+    cache.items.equal_range(key);
+  for (ItemMap::iterator it = range.first; it != range.second; ++it) {
+    if (!key.tiled || it->second->count == 0) {
+      item = it->second;
+      break;
+    }
+  }
+
+  XGCValues gcv;
+  unsigned long mask = 0ul;
+  if (key.tiled) {
+    // fills repeat the tile, starting at the tile origin
+    gcv.tile = tile;
+    gcv.ts_x_origin = tile_x;
+    gcv.ts_y_origin = tile_y;
+    mask |= GCTile | GCTileStipXOrigin | GCTileStipYOrigin;
+  }
+
+  if (item) {
+    if (item->count == 0)
+      cache.unused.erase(item->lru);
+    if (mask)
+      XChangeGC(XDisplay(), item->gc, mask, &gcv);
+  } else {
+    gcv.foreground = key.pixel;
+    gcv.function = key.function;
+    gcv.line_width = key.linewidth;
+    gcv.subwindow_mode = key.subwindow;
+    gcv.fill_style = key.tiled ? FillTiled : FillSolid;
+    mask |= (GCForeground
+             | GCFunction
+             | GCLineWidth
+             | GCSubwindowMode
+             | GCFillStyle);
+    GC gc = XCreateGC(XDisplay(),
+                      _display.screenInfo(screen).rootWindow(),
+                      mask, &gcv);
+    item = new Item(screen, gc);
+    item->entry = cache.items.insert(ItemMap::value_type(key, item));
+
+#ifdef PENCACHE_DEBUG
+    fprintf(stderr, gettext("bt::PenCache: add GC %p, %u on screen %u\n"),
+            static_cast<void *>(gc),
+            static_cast<unsigned int>(cache.items.size()), screen);
+#endif // PENCACHE_DEBUG
+  }
+
+  ++item->count;
+  return item;
+}
+
+
+void bt::PenCache::release(Item *item)
+{
+  assert(item->count > 0);
+  if (--item->count > 0)
+    return;
+
+  ScreenCache &cache = screenCache(item->screen);
+  if (item->entry->first.tiled) {
+    // don't keep the tile alive, it may be a pixmap the image cache
+    // has already let go of
+    if (!cache.blank) {
+      const ScreenInfo &screeninfo = _display.screenInfo(item->screen);
+      cache.blank = XCreatePixmap(XDisplay(), screeninfo.rootWindow(),
+                                  1u, 1u, screeninfo.depth());
+    }
+    XGCValues gcv;
+    gcv.tile = cache.blank;
+    XChangeGC(XDisplay(), item->gc, GCTile, &gcv);
+  }
+  cache.unused.push_front(item);
+  item->lru = cache.unused.begin();
+
+  // trim the least recently used
+  while (cache.unused.size() > UnusedLimit) {
+    Item * const last = cache.unused.back();
+    cache.unused.pop_back();
+    remove(last);
+  }
+}
+
+
+void bt::PenCache::remove(Item *item)
+{
+  assert(item->count == 0);
+
+#ifdef PENCACHE_DEBUG
+  fprintf(stderr, gettext("bt::PenCache: free GC %p on screen %u\n"),
+          static_cast<void *>(item->gc), item->screen);
+#endif // PENCACHE_DEBUG
+
+  screenCache(item->screen).items.erase(item->entry);
+  XFreeGC(XDisplay(), item->gc);
+  delete item;
+}
+
+
+XftDraw *bt::PenCache::xftDraw(unsigned int screen, Drawable drawable)
+{
+#ifdef XFT
+  XftDrawMap::iterator it = xftdraws.find(drawable);
+  if (it != xftdraws.end())
+    return it->second;
+
+  const ScreenInfo &screeninfo = _display.screenInfo(screen);
+  XftDraw * const xftdraw = XftDrawCreate(XDisplay(),
+                                          drawable,
+                                          screeninfo.visual(),
+                                          screeninfo.colormap());
+  assert(xftdraw != 0);
+  xftdraws.insert(XftDrawMap::value_type(drawable, xftdraw));
+  return xftdraw;
+#else
+  (void) screen;
+  (void) drawable;
+  return 0;
+#endif
+}
+
+
+void bt::PenCache::releaseDrawable(Drawable drawable)
+{
+  XftDrawMap::iterator it = xftdraws.find(drawable);
+  if (it == xftdraws.end())
+    return;
+#ifdef XFT
+  XftDrawDestroy(it->second);
+#endif
+  xftdraws.erase(it);
+}
+
+
 bt::Pen::Pen(unsigned int screen_)
   : _screen(screen_), _function(GXcopy),  _linewidth(0),
-    _subwindow(ClipByChildren), _dirty(false), _gc(0), _xftdraw(0)
+    _subwindow(ClipByChildren), _tile(0ul), _tile_x(0), _tile_y(0),
+    _dirty(false), _item(0)
 { }
 
 bt::Pen::Pen(unsigned int screen_, const Color &color_)
   : _screen(screen_), _color(color_), _function(GXcopy), _linewidth(0),
-    _subwindow(ClipByChildren), _dirty(false), _gc(0), _xftdraw(0)
+    _subwindow(ClipByChildren), _tile(0ul), _tile_x(0), _tile_y(0),
+    _dirty(false), _item(0)
 { }
 
 bt::Pen::~Pen(void)
 {
-  if (_gc)
-    XFreeGC(penloader->XDisplay(), _gc);
-  _gc = 0;
-
-#ifdef XFT
-  if (_xftdraw)
-    XftDrawDestroy(_xftdraw);
-  _xftdraw = 0;
-#endif
+  if (_item)
+    pencache->release(_item);
+  _item = 0;
 }
 
 void bt::Pen::setColor(const Color &color_)
@@ -114,60 +363,47 @@ void bt::Pen::setSubWindowMode(int subwindow)
   _dirty = true;
 }
 
+void bt::Pen::setTile(Pixmap tile, int x, int y)
+{
+  _tile = tile;
+  _tile_x = x;
+  _tile_y = y;
+  _dirty = true;
+}
+
 ::Display *bt::Pen::XDisplay(void) const
-{ return penloader->XDisplay(); }
+{ return pencache->XDisplay(); }
 
 const bt::Display &bt::Pen::display(void) const
-{ return penloader->display(); }
+{ return pencache->display(); }
 
 const GC &bt::Pen::gc(void) const
 {
-  if (!_gc || _dirty) {
-    XGCValues gcv;
-    gcv.foreground = _color.pixel(_screen);
-    gcv.function = _function;
-    gcv.line_width = _linewidth;
-    gcv.subwindow_mode = _subwindow;
-    if (!_gc) {
-      _gc = XCreateGC(penloader->XDisplay(),
-                      penloader->display().screenInfo(_screen).rootWindow(),
-                      (GCForeground
-                       | GCFunction
-                       | GCLineWidth
-                       | GCSubwindowMode),
-                      &gcv);
-
-    } else {
-      XChangeGC(penloader->XDisplay(),
-                _gc,
-                (GCForeground
-                 | GCFunction
-                 | GCLineWidth
-                 | GCSubwindowMode),
-                &gcv);
-    }
+  if (!_item || _dirty) {
+    PenCache::Key key;
+    key.pixel = _color.pixel(_screen);
+    key.function = _function;
+    key.linewidth = _linewidth;
+    key.subwindow = _subwindow;
+    key.tiled = (_tile != 0ul);
+
+    // take the new GC first, it may well be the same one
+    PenCache::Item * const item =
+      pencache->find(_screen, key, _tile, _tile_x, _tile_y);
+    if (_item)
+      pencache->release(_item);
+    _item = item;
     _dirty = false;
   }
-  assert(_gc != 0);
-  return _gc;
+  assert(_item != 0);
+  return _item->gc;
 }
 
 XftDraw *bt::Pen::xftDraw(Drawable drawable) const
+{ return pencache->xftDraw(_screen, drawable); }
+
+void bt::Pen::releaseDrawable(Drawable drawable)
 {
-#ifdef XFT
-  if (!_xftdraw) {
-    const ScreenInfo &screeninfo = penloader->display().screenInfo(_screen);
-    _xftdraw = XftDrawCreate(penloader->XDisplay(),
-                             drawable,
-                             screeninfo.visual(),
-                             screeninfo.colormap());
-  } else if (XftDrawDrawable(_xftdraw) != drawable) {
-    XftDrawChange(_xftdraw, drawable);
-  }
-  assert(_xftdraw != 0);
-  return _xftdraw;
-#else
-  return 0;
-#endif
+  if (pencache)
+    pencache->releaseDrawable(drawable);
 }
-
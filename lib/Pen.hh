@@ -34,6 +34,7 @@ namespace bt {
 
   // forward declarations
   class Display;
+  struct PenCacheItem;
 
   class Pen : public NoCopy {
   public:
@@ -50,13 +51,32 @@ namespace bt {
     void setGCFunction(int function);
     void setLineWidth(int linewidth);
     void setSubWindowMode(int subwindow);
+    void setTile(Pixmap tile, int x = 0, int y = 0);
 
     ::Display *XDisplay(void) const;
     const Display &display(void) const;
+    /*
+      Returns a GC with the pen's state.  The GC is shared with other
+      Pens with the same state, so anything changed on it directly
+      (e.g. the clip mask) must be restored before drawing with
+      another Pen.
+    */
     const GC &gc(void) const;
 
+    /*
+      Returns the XftDraw for the drawable.  It is shared by all Pens
+      on the drawable and kept until releaseDrawable() is called.
+    */
     XftDraw *xftDraw(Drawable drawable) const;
 
+    /*
+      Destroys the XftDraw kept for the drawable, if any.  This must
+      be done before the drawable is destroyed.
+      Application::removeEventHandler() does it for all windows with
+      an event handler.
+    */
+    static void releaseDrawable(Drawable drawable);
+
   private:
     unsigned int _screen;
 
@@ -64,10 +84,11 @@ namespace bt {
     int _function;
     int _linewidth;
     int _subwindow;
+    Pixmap _tile;
+    int _tile_x, _tile_y;
 
     mutable bool _dirty;
-    mutable GC _gc;
-    mutable XftDraw *_xftdraw;
+    mutable PenCacheItem *_item;
   };
 
 } // namespace bt
@@ -31,16 +31,132 @@
 
 #include <X11/Xlib.h>
 #include <assert.h>
+#include <sys/time.h>
 #include <cstdio>
+#include <cstring>
 
 #include <algorithm>
+#include <deque>
 #include <list>
+#include <vector>
 
 // #define PIXMAPCACHE_DEBUG
 
 
 namespace bt {
 
+  // mixes all bits of a 64-bit value into the low bits
+  static inline unsigned long long mixHash(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+  }
+
+  static inline unsigned long long itemHash(unsigned long long fingerprint,
+                                            unsigned int screen,
+                                            unsigned int width,
+                                            unsigned int height) {
+    return mixHash(fingerprint
+                   ^ (static_cast<unsigned long long>(width) << 40)
+                   ^ (static_cast<unsigned long long>(height) << 16)
+                   ^ screen);
+  }
+
+  static inline unsigned long long pixmapHash(Pixmap pixmap)
+  { return mixHash(pixmap); }
+
+
+  /*
+    An open addressing hash table (linear probing, at most half full)
+    of pointers to items stored elsewhere.  Key::hash(item) gives the
+    hash of a stored item; lookups pass the hash and a predicate.
+    Erasing shifts the following entries back instead of leaving
+    tombstones, so lookups never degrade.
+  */
+  template <class Item, class Key>
+  class HashIndex {
+  public:
+    inline HashIndex(void)
+      : slots(16, static_cast<Item *>(0)), used(0)
+    { }
+
+    template <class Match>
+    Item *find(unsigned long long hash, const Match &match) const {
+      const size_t mask = slots.size() - 1;
+      for (size_t i = hash & mask; slots[i]; i = (i + 1) & mask) {
+        if (match(*slots[i]))
+          return slots[i];
+      }
+      return 0;
+    }
+
+    void insert(Item *item) {
+      if ((used + 1) * 2 > slots.size())
+        rehash(slots.size() * 2);
+      place(item);
+      ++used;
+    }
+
+    void erase(const Item *item) {
+      const size_t mask = slots.size() - 1;
+      size_t i = Key::hash(*item) & mask;
+      while (slots[i] != item) {
+        assert(slots[i] != 0);
+        i = (i + 1) & mask;
+      }
+
+      // move back entries that probed past the hole
+      size_t j = i;
+      for (;;) {
+        slots[i] = 0;
+        for (;;) {
+          j = (j + 1) & mask;
+          if (!slots[j]) {
+            --used;
+            return;
+          }
+          const size_t k = Key::hash(*slots[j]) & mask;
+          // stays put if its home slot k lies cyclically in (i, j]
+          if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+          break;
+        }
+        slots[i] = slots[j];
+        i = j;
+      }
+    }
+
+    void clear(void) {
+      std::fill(slots.begin(), slots.end(), static_cast<Item *>(0));
+      used = 0;
+    }
+
+  private:
+    void place(Item *item) {
+      const size_t mask = slots.size() - 1;
+      size_t i = Key::hash(*item) & mask;
+      while (slots[i])
+        i = (i + 1) & mask;
+      slots[i] = item;
+    }
+
+    void rehash(size_t size) {
+      std::vector<Item *> old(size, static_cast<Item *>(0));
+      old.swap(slots);
+      for (size_t i = 0; i < old.size(); ++i) {
+        if (old[i])
+          place(old[i]);
+      }
+    }
+
+    std::vector<Item *> slots;
+    size_t used;
+  };
+
+
   class RealPixmapCache {
   public:
     RealPixmapCache(const Display &display);
@@ -54,52 +170,118 @@ namespace bt {
 
     void clear(bool force);
 
+    void prewarm(unsigned int screen, const Texture &texture,
+                 unsigned int width, unsigned int height);
+    bool renderIdle(void);
+
+    unsigned long cacheLimit(unsigned int screen) const
+    { return screens[screen].limit; }
+    void setCacheLimit(unsigned int screen, unsigned long limit);
+    unsigned long memoryUsage(unsigned int screen) const
+    { return screens[screen].usage; }
+
+    struct CacheItem;
+    typedef std::list<CacheItem *> ItemList;
+
     struct CacheItem {
       const Texture texture;
+      const unsigned long long hash;
       const unsigned int screen;
       const unsigned int width;
       const unsigned int height;
+      const unsigned long bytes;
       Pixmap pixmap;
       unsigned int count;
+      ItemList::iterator entry; // in cache
+      ItemList::iterator lru;   // in unused, while count == 0
 
-      inline CacheItem(void)
-        : screen(~0u), width(0u), height(0u),
-          pixmap(0ul), count(0u)
-      { }
       inline CacheItem(const unsigned int s, const Texture &t,
-                       const unsigned int w, const unsigned int h)
-        : texture(t), screen(s), width(w), height(h),
+                       const unsigned long long hh,
+                       const unsigned int w, const unsigned int h,
+                       const unsigned long b)
+        : texture(t), hash(hh), screen(s), width(w), height(h), bytes(b),
           pixmap(0ul), count(1u)
       { }
+    };
+
+    struct ItemKey {
+      static inline unsigned long long hash(const CacheItem &item)
+      { return item.hash; }
+    };
+
+    struct PixmapKey {
+      static inline unsigned long long hash(const CacheItem &item)
+      { return pixmapHash(item.pixmap); }
+    };
 
-      inline bool operator==(const CacheItem &x) const {
-        return texture == x.texture &&
-                screen == x.screen &&
-                 width == x.width &&
-                height == x.height;
+    struct ItemMatch {
+      inline ItemMatch(unsigned long long hh, unsigned int s,
+                       const Texture &t, unsigned int w, unsigned int h)
+        : hash(hh), screen(s), texture(t), width(w), height(h)
+      { }
+      inline bool operator()(const CacheItem &item) const {
+        // the texture is compared last, it is the most expensive
+        return item.hash == hash &&
+             item.screen == screen &&
+              item.width == width &&
+             item.height == height &&
+            item.texture == texture;
       }
+
+      const unsigned long long hash;
+      const unsigned int screen;
+      const Texture &texture;
+      const unsigned int width, height;
     };
 
     struct PixmapMatch {
       inline PixmapMatch(Pixmap p)
         : pixmap(p)
       { }
-      inline bool operator()(const RealPixmapCache::CacheItem& item) const
+      inline bool operator()(const CacheItem& item) const
       { return item.pixmap == pixmap; }
 
       const Pixmap pixmap;
     };
 
+    struct ScreenCache {
+      unsigned long limit; // in bytes
+      unsigned long usage; // in bytes
+      unsigned int bits_per_pixel;
+      unsigned int scanline_pad;
+      // unreferenced items, most recently released first
+      ItemList unused;
+      PixmapCache::Statistics stats;
+    };
+
+    unsigned long pixmapSize(unsigned int screen,
+                             unsigned int width, unsigned int height) const;
+    CacheItem *render(unsigned int screen, const Texture &texture,
+                      unsigned long long hash,
+                      unsigned int width, unsigned int height,
+                      bool prewarmed);
+    void evict(unsigned int screen);
+    void remove(CacheItem *item);
+
     const Display &_display;
 
-    typedef std::list<CacheItem> Cache;
-    Cache cache;
+    struct PrewarmItem {
+      Texture texture;
+      unsigned int screen;
+      unsigned int width;
+      unsigned int height;
+    };
+
+    // every item is in the cache, the indexes point into it
+    ItemList cache;
+    HashIndex<CacheItem, ItemKey> items;
+    HashIndex<CacheItem, PixmapKey> pixmaps;
+    std::vector<ScreenCache> screens;
+    std::deque<PrewarmItem> prewarm_queue;
   };
 
 
   static RealPixmapCache *realpixmapcache = 0;
-  static unsigned long maxmem_usage = 2ul*1024ul*1024ul; // 2mb default
-  static unsigned long mem_usage = 0ul;
 
 
   void createPixmapCache(const Display &display) {
@@ -111,20 +293,113 @@ namespace bt {
   void destroyPixmapCache(void) {
     delete realpixmapcache;
     realpixmapcache = 0;
+  }
+
+
+  /*
+    Shrinks width and height to the smallest strip that, when tiled,
+    gives the same image as the texture rendered at full size.
+    Horizontal and vertical gradients only change along one axis;
+    interlacing a horizontal gradient repeats every second line.
+    Bevels and borders are drawn on the edges of the full image, and
+    dithering depends on the position of each pixel, so those
+    textures are rendered at full size.
+  */
+  static void stripSize(const Display &display, unsigned int screen,
+                        const Texture &texture,
+                        unsigned int &width, unsigned int &height) {
+    const unsigned long t = texture.texture();
+    if (!(t & Texture::Gradient)
+        || (t & (Texture::Raised | Texture::Sunken | Texture::Border)))
+      return;
+
+    // same precedence as Image::render()
+    if (t & (Texture::Diagonal | Texture::Elliptic))
+      return;
+    if (t & Texture::Horizontal) {
+      const unsigned int h = (t & Texture::Interlaced) ? 2u : 1u;
+      if (height <= h || Image::isDithered(display, screen))
+        return;
+      height = h;
+    } else if (t & (Texture::Pyramid | Texture::Rectangle)) {
+      return;
+    } else if (t & Texture::Vertical) {
+      if (width <= 1u || Image::isDithered(display, screen))
+        return;
+      width = 1u;
+    }
+  }
 
-    assert(mem_usage == 0ul);
+
+  static const char * const gradient_names[PixmapCache::GradientTypes] = {
+    "diagonal", "elliptic", "horizontal", "pyramid", "rectangle",
+    "vertical", "crossdiagonal", "pipecross", "splitvertical"
+  };
+
+  // index into gradient_names, same precedence as Image::render()
+  static unsigned int gradientType(const Texture &texture) {
+    static const unsigned long types[PixmapCache::GradientTypes] = {
+      Texture::Diagonal, Texture::Elliptic, Texture::Horizontal,
+      Texture::Pyramid, Texture::Rectangle, Texture::Vertical,
+      Texture::CrossDiagonal, Texture::PipeCross, Texture::SplitVertical
+    };
+    unsigned int i = 0;
+    while (i < PixmapCache::GradientTypes - 1
+           && !(texture.texture() & types[i]))
+      ++i;
+    return i;
+  }
+
+  static unsigned int renderTimeBucket(unsigned long usec) {
+    static const unsigned long bounds[PixmapCache::RenderTimeBuckets - 1] = {
+      50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000
+    };
+    unsigned int i = 0;
+    while (i < PixmapCache::RenderTimeBuckets - 1 && usec >= bounds[i])
+      ++i;
+    return i;
   }
 
 } // namespace bt
 
 
 bt::RealPixmapCache::RealPixmapCache(const Display &display)
-  : _display(display)
-{ }
+  : _display(display), screens(display.screenCount())
+{
+  int count = 0;
+  XPixmapFormatValues *formats =
+    XListPixmapFormats(_display.XDisplay(), &count);
+
+  for (unsigned int i = 0; i < screens.size(); ++i) {
+    ScreenCache &sc = screens[i];
+    sc.limit = 2ul*1024ul*1024ul; // 2mb default
+    sc.usage = 0ul;
+    memset(&sc.stats, 0, sizeof(sc.stats));
+
+    // pixmaps are stored like images in ZPixmap format
+    const int depth = _display.screenInfo(i).depth();
+    sc.bits_per_pixel = depth;
+    sc.scanline_pad = 8;
+    for (int f = 0; f < count; ++f) {
+      if (formats[f].depth != depth)
+        continue;
+      sc.bits_per_pixel = formats[f].bits_per_pixel;
+      sc.scanline_pad = formats[f].scanline_pad;
+      break;
+    }
+  }
+
+  if (formats)
+    XFree(formats);
+}
 
 
-bt::RealPixmapCache::~RealPixmapCache(void)
-{ clear(true); }
+bt::RealPixmapCache::~RealPixmapCache(void) {
+  clear(true);
+
+  for (unsigned int i = 0; i < screens.size(); ++i)
+    assert(screens[i].usage == 0ul);
+}
 
 
 Pixmap bt::RealPixmapCache::find(unsigned int screen,
@@ -139,13 +414,21 @@ Pixmap bt::RealPixmapCache::find(unsigned int screen,
   if (texture.texture() == Texture::Parent_Relative)
     return ParentRelative;
 
+  stripSize(_display, screen, texture, width, height);
+
   Pixmap p;
   // find one in the cache
-  CacheItem item(screen, texture, width, height);
-  Cache::iterator it = std::find(cache.begin(), cache.end(), item);
+  const unsigned long long hash =
+    itemHash(texture.fingerprint(), screen, width, height);
+  CacheItem *it =
+    items.find(hash, ItemMatch(hash, screen, texture, width, height));
 
-  if (it != cache.end()) {
+  ScreenCache &sc = screens[screen];
+  if (it) {
     // found
+    ++sc.stats.hits;
+    if (it->count == 0)
+      sc.unused.erase(it->lru);
     ++(it->count);
 
     p = it->pixmap;
@@ -155,40 +438,90 @@ Pixmap bt::RealPixmapCache::find(unsigned int screen,
             it->pixmap, width, height, it->count);
 #endif // PIXMAPCACHE_DEBUG
   } else {
-    Image image(width, height);
-    p = image.render(_display, screen, texture);
+    ++sc.stats.misses;
 
-    if (p) {
-      item.pixmap = p;
+    const CacheItem * const item =
+      render(screen, texture, hash, width, height, false);
+    p = item ? item->pixmap : None;
+  }
 
-#ifdef PIXMAPCACHE_DEBUG
-      fprintf(stderr,
-              gettext("bt::PixmapCache: add %08lx %4ux%4u\n"
-                      "                 mem %8lu max %8lu\n"),
-              p, width, height, mem_usage, maxmem_usage);
-#endif // PIXMAPCACHE_DEBUG
+  return p;
+}
+
+
+/*
+  Renders a pixmap and adds it to the cache.  A pixmap found by find()
+  is referenced once and counted as a render; a prewarmed pixmap is
+  not referenced, and is counted separately so that the lookup and
+  render counters only describe find().  Returns 0 if nothing was
+  rendered.
+*/
+bt::RealPixmapCache::CacheItem *
+bt::RealPixmapCache::render(unsigned int screen, const Texture &texture,
+                            unsigned long long hash,
+                            unsigned int width, unsigned int height,
+                            bool prewarmed) {
+  ScreenCache &sc = screens[screen];
+
+  ::timeval start, end;
+  gettimeofday(&start, 0);
+
+  Image image(width, height);
+  const Pixmap p = image.render(_display, screen, texture);
+  if (!p)
+    return 0;
+
+  if (prewarmed) {
+    ++sc.stats.prewarms;
+  } else {
+    gettimeofday(&end, 0);
+    const unsigned long usec = (end.tv_sec - start.tv_sec) * 1000000l
+                               + (end.tv_usec - start.tv_usec);
+    const unsigned int type = gradientType(texture);
+    ++sc.stats.renders;
+    sc.stats.render_usec[type] += usec;
+    ++sc.stats.render_times[type][renderTimeBucket(usec)];
+  }
 
-      cache.push_front(item);
+  CacheItem *item =
+    new CacheItem(screen, texture, hash, width, height,
+                  pixmapSize(screen, width, height));
+  item->pixmap = p;
+  item->entry = cache.insert(cache.end(), item);
+  items.insert(item);
+  pixmaps.insert(item);
+
+  if (prewarmed) {
+    // keep it as an unused pixmap
+    item->count = 0;
+    sc.unused.push_front(item);
+    item->lru = sc.unused.begin();
+  }
 
-      // keep track of memory usage server side
-      const unsigned long mem =
-        ( ( width * height ) * (_display.screenInfo(screen).depth() / 8 ) );
-      mem_usage += mem;
-      if (mem_usage > maxmem_usage)
-        clear(false);
+  // keep track of memory usage server side
+  sc.usage += item->bytes;
+  ++sc.stats.pixmaps;
 
 #ifdef PIXMAPCACHE_DEBUG
-      if (mem_usage > maxmem_usage) {
-        fprintf(stderr,
-                gettext("bt::PixmapCache: maximum size (%lu kb) exceeded\n"
-                        "bt::PixmapCache: current size: %lu kb\n"),
-                maxmem_usage / 1024, mem_usage / 1024);
-      }
+  fprintf(stderr,
+          gettext("bt::PixmapCache: add %08lx %4ux%4u\n"
+                  "                 mem %8lu max %8lu\n"),
+          p, width, height, sc.usage, sc.limit);
 #endif // PIXMAPCACHE_DEBUG
-    }
+
+  if (sc.usage > sc.limit)
+    evict(screen);
+
+#ifdef PIXMAPCACHE_DEBUG
+  if (sc.usage > sc.limit) {
+    fprintf(stderr,
+            gettext("bt::PixmapCache: maximum size (%lu kb) exceeded\n"
+                    "bt::PixmapCache: current size: %lu kb\n"),
+            sc.limit / 1024, sc.usage / 1024);
   }
+#endif // PIXMAPCACHE_DEBUG
 
-  return p;
+  return item;
 }
 
 
@@ -196,9 +529,8 @@ void bt::RealPixmapCache::release(Pixmap pixmap) {
   if (!pixmap || pixmap == ParentRelative)
     return;
 
-  Cache::iterator it = std::find_if(cache.begin(), cache.end(),
-                                    PixmapMatch(pixmap));
-  assert(it != cache.end() && it->count > 0);
+  CacheItem *it = pixmaps.find(pixmapHash(pixmap), PixmapMatch(pixmap));
+  assert(it != 0 && it->count > 0);
 
   // decrement the refcount
   --(it->count);
@@ -207,10 +539,22 @@ void bt::RealPixmapCache::release(Pixmap pixmap) {
   fprintf(stderr, gettext("bt::PixmapCache: rel %08lx %4ux%4u, count %4u\n"),
           it->pixmap, it->width, it->height, it->count);
 #endif // PIXMAPCACHE_DEBUG
+
+  if (it->count == 0) {
+    ScreenCache &sc = screens[it->screen];
+    sc.unused.push_front(it);
+    it->lru = sc.unused.begin();
+
+    if (sc.usage > sc.limit)
+      evict(it->screen);
+  }
 }
 
 
 void bt::RealPixmapCache::clear(bool force) {
+  // scheduled renders are for what the cache held
+  prewarm_queue.clear();
+
   if (cache.empty())
     return; // nothing to do
 
@@ -219,56 +563,212 @@ void bt::RealPixmapCache::clear(bool force) {
           cache.size());
 #endif // PIXMAPCACHE_DEBUG
 
-  Cache::iterator it = cache.begin();
+  ItemList::iterator it = cache.begin();
   while (it != cache.end()) {
-    if (it->count != 0 && !force) {
+    CacheItem *item = *it++;
+    if (item->count != 0 && !force) {
 #ifdef PIXMAPCACHE_DEBUG
       fprintf(stderr, gettext("bt::PixmapCache: skp %08lx %4ux%4u, count %4u\n"),
-              it->pixmap, it->width, it->height, it->count);
+              item->pixmap, item->width, item->height, item->count);
 #endif // PIXMAPCACHE_DEBUG
-
-      ++it;
       continue;
     }
 
+    remove(item);
+  }
+
 #ifdef PIXMAPCACHE_DEBUG
-    fprintf(stderr, gettext("bt::PixmapCache: fre %08lx %4ux%4u\n"),
-            it->pixmap, it->width, it->height);
+  fprintf(stderr,
+          gettext("bt::PixmapCache: cleared, %u entries remain\n"),
+          cache.size());
 #endif // PIXMAPCACHE_DEBUG
+}
+
+
+void bt::RealPixmapCache::prewarm(unsigned int screen,
+                                  const Texture &texture,
+                                  unsigned int width, unsigned int height) {
+  if (!(texture.texture() & Texture::Gradient))
+    return; // nothing to render
+
+  PrewarmItem item;
+  item.texture = texture;
+  item.screen = screen;
+  item.width = width;
+  item.height = height;
+  prewarm_queue.push_back(item);
+}
+
+
+bool bt::RealPixmapCache::renderIdle(void) {
+  if (prewarm_queue.empty())
+    return false;
+
+  const PrewarmItem item = prewarm_queue.front();
+  prewarm_queue.pop_front();
+
+  unsigned int width = item.width, height = item.height;
+  stripSize(_display, item.screen, item.texture, width, height);
+
+  const unsigned long long hash =
+    itemHash(item.texture.fingerprint(), item.screen, width, height);
+  const ScreenCache &sc = screens[item.screen];
+  if (!items.find(hash, ItemMatch(hash, item.screen, item.texture,
+                                  width, height))
+      && sc.usage + pixmapSize(item.screen, width, height) <= sc.limit)
+    render(item.screen, item.texture, hash, width, height, true);
+
+  return !prewarm_queue.empty();
+}
+
+
+void bt::RealPixmapCache::setCacheLimit(unsigned int screen,
+                                        unsigned long limit) {
+  ScreenCache &sc = screens[screen];
+  sc.limit = limit;
+  if (sc.usage > sc.limit)
+    evict(screen);
+}
+
 
-    // keep track of memory usage server side
-    const unsigned long mem =
-      ( ( it->width * it->height ) *
-        (_display.screenInfo(it->screen).depth() / 8 ) );
-    assert(mem <= mem_usage);
-    mem_usage -= mem;
+/*
+  Returns the server side size of a pixmap, using the same layout as a
+  ZPixmap image of the screen's depth.
+*/
+unsigned long bt::RealPixmapCache::pixmapSize(unsigned int screen,
+                                              unsigned int width,
+                                              unsigned int height) const {
+  const ScreenCache &sc = screens[screen];
+  const unsigned long pad = sc.scanline_pad;
+  const unsigned long line =
+    (width * sc.bits_per_pixel + pad - 1) / pad * pad / 8;
+  return line * height;
+}
 
-    // free pixmap
-    XFreePixmap(_display.XDisplay(), it->pixmap);
 
-    // remove from cache
-    it = cache.erase(it);
+/*
+  Frees unreferenced pixmaps, least recently released first, until the
+  screen is back within its limit.
+*/
+void bt::RealPixmapCache::evict(unsigned int screen) {
+  ScreenCache &sc = screens[screen];
+  while (sc.usage > sc.limit && !sc.unused.empty()) {
+    remove(sc.unused.back());
+    ++sc.stats.evictions;
   }
+}
+
 
+void bt::RealPixmapCache::remove(CacheItem *item) {
 #ifdef PIXMAPCACHE_DEBUG
-  fprintf(stderr,
-          gettext("bt::PixmapCache: cleared, %u entries remain\n"
-                  "                 mem %8lu max %8lu\n"),
-          cache.size(), mem_usage, maxmem_usage);
+  fprintf(stderr, gettext("bt::PixmapCache: fre %08lx %4ux%4u\n"),
+          item->pixmap, item->width, item->height);
 #endif // PIXMAPCACHE_DEBUG
+
+  // keep track of memory usage server side
+  ScreenCache &sc = screens[item->screen];
+  assert(item->bytes <= sc.usage);
+  sc.usage -= item->bytes;
+  --sc.stats.pixmaps;
+  if (item->count == 0)
+    sc.unused.erase(item->lru);
+
+  // free pixmap
+  XFreePixmap(_display.XDisplay(), item->pixmap);
+
+  // remove from cache
+  items.erase(item);
+  pixmaps.erase(item);
+  cache.erase(item->entry);
+  delete item;
+}
+
+
+unsigned long bt::PixmapCache::cacheLimit(void) {
+  unsigned long limit = 0ul;
+  for (unsigned int i = 0; i < realpixmapcache->screens.size(); ++i)
+    limit += realpixmapcache->cacheLimit(i);
+  return limit / 1024;
 }
 
 
-unsigned long bt::PixmapCache::cacheLimit(void)
-{ return maxmem_usage / 1024; }
+unsigned long bt::PixmapCache::cacheLimit(unsigned int screen)
+{ return realpixmapcache->cacheLimit(screen) / 1024; }
 
 
-void bt::PixmapCache::setCacheLimit(unsigned long limit)
-{ maxmem_usage = limit * 1024; }
+void bt::PixmapCache::setCacheLimit(unsigned long limit) {
+  for (unsigned int i = 0; i < realpixmapcache->screens.size(); ++i)
+    realpixmapcache->setCacheLimit(i, limit * 1024);
+}
 
 
-unsigned long bt::PixmapCache::memoryUsage(void)
-{ return mem_usage / 1024; }
+void bt::PixmapCache::setCacheLimit(unsigned int screen, unsigned long limit)
+{ realpixmapcache->setCacheLimit(screen, limit * 1024); }
+
+
+unsigned long bt::PixmapCache::memoryUsage(void) {
+  unsigned long usage = 0ul;
+  for (unsigned int i = 0; i < realpixmapcache->screens.size(); ++i)
+    usage += realpixmapcache->memoryUsage(i);
+  return usage / 1024;
+}
+
+
+unsigned long bt::PixmapCache::memoryUsage(unsigned int screen)
+{ return realpixmapcache->memoryUsage(screen) / 1024; }
+
+
+bt::PixmapCache::Statistics
+bt::PixmapCache::statistics(unsigned int screen) {
+  Statistics stats = realpixmapcache->screens[screen].stats;
+  stats.memory = memoryUsage(screen);
+  return stats;
+}
+
+
+std::string bt::PixmapCache::statisticsReport(unsigned int screen) {
+  static const char * const bucket_names[RenderTimeBuckets] = {
+    "<50us", "<100us", "<200us", "<500us", "<1ms", "<2ms", "<5ms",
+    "<10ms", "<20ms", ">=20ms"
+  };
+
+  const Statistics stats = statistics(screen);
+  std::string report;
+  char line[256];
+
+  sprintf(line, "hits %lu, misses %lu, renders %lu, prewarms %lu, "
+          "evictions %lu\n", stats.hits, stats.misses, stats.renders,
+          stats.prewarms, stats.evictions);
+  report += line;
+  sprintf(line, "%lu pixmaps, %lu kb of %lu kb\n",
+          stats.pixmaps, stats.memory, cacheLimit(screen));
+  report += line;
+
+  for (unsigned int i = 0; i < GradientTypes; ++i) {
+    unsigned long renders = 0;
+    for (unsigned int b = 0; b < RenderTimeBuckets; ++b)
+      renders += stats.render_times[i][b];
+    if (renders == 0)
+      continue;
+
+    sprintf(line, "%s: %lu renders, %lu us", gradient_names[i], renders,
+            stats.render_usec[i]);
+    report += line;
+    for (unsigned int b = 0; b < RenderTimeBuckets; ++b) {
+      if (stats.render_times[i][b] == 0)
+        continue;
+      sprintf(line, ", %s %lu", bucket_names[b], stats.render_times[i][b]);
+      report += line;
+    }
+    report += '\n';
+  }
+
+  sprintf(line, "render buffer allocations %lu\n",
+          Image::bufferAllocations());
+  report += line;
+
+  return report;
+}
 
 
 Pixmap bt::PixmapCache::find(unsigned int screen,
@@ -278,6 +778,16 @@ Pixmap bt::PixmapCache::find(unsigned int screen,
 { return realpixmapcache->find(screen, texture, width, height, old_pixmap); }
 
 
+void bt::PixmapCache::prewarm(unsigned int screen,
+                              const Texture &texture,
+                              unsigned int width, unsigned int height)
+{ realpixmapcache->prewarm(screen, texture, width, height); }
+
+
+bool bt::PixmapCache::renderIdle(void)
+{ return realpixmapcache->renderIdle(); }
+
+
 void bt::PixmapCache::release(Pixmap pixmap)
 { realpixmapcache->release(pixmap); }
 
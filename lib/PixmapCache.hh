@@ -35,33 +35,95 @@ namespace bt {
   class PixmapCache : public NoCopy {
   public:
     /*
-      Returns the cache limit in kilobytes.  The default is one
-      megabyte (1024 kilobytes).
+      Returns the cache limit in kilobytes for the specified screen.
+      The default is two megabytes (2048 kilobytes).
 
-      When this limit is reached, the cache will automatically free
-      unused pixmaps to reduce the amount of server side memory used.
+      When this limit is reached, the cache will free unused pixmaps,
+      least recently used first, until the server side memory used for
+      the screen is below the limit again.
 
       NOTE: This limit is not a hard limit.  The cache will never free
       a pixmap that is in use.  This means it is possible that the
       PixmapCache memory usage can exceed this limit.
     */
+    static unsigned long cacheLimit(unsigned int screen);
+
+    /*
+      Returns the sum of the cache limits of all screens.
+    */
     static unsigned long cacheLimit(void);
 
     /*
-      Set the cache limit to the specified value (in kilobytes).
+      Set the cache limit for the specified screen to the specified
+      value (in kilobytes).
+    */
+    static void setCacheLimit(unsigned int screen, unsigned long limit);
+
+    /*
+      Set the cache limit for all screens to the specified value (in
+      kilobytes).
     */
     static void setCacheLimit(unsigned long limit);
 
     /*
       Returns the current amount of memory in kilobytes used by the X
-      server for the pixmaps in the cache.
+      server for the pixmaps in the cache for the specified screen.
+    */
+    static unsigned long memoryUsage(unsigned int screen);
+
+    /*
+      Returns the current amount of memory in kilobytes used by the X
+      server for the pixmaps in the cache for all screens.
     */
     static unsigned long memoryUsage(void);
 
+    enum {
+      // gradient types, in the order Image::render() checks them
+      GradientTypes = 9,
+      RenderTimeBuckets = 10
+    };
+
+    /*
+      Counters for one screen, kept since startup.
+
+      Render times are counted per gradient type in buckets with
+      upper bounds of 50, 100, 200 and 500 microseconds, 1, 2, 5, 10
+      and 20 milliseconds; the last bucket counts everything slower.
+    */
+    struct Statistics {
+      unsigned long hits;      // found in the cache
+      unsigned long misses;    // not found in the cache
+      unsigned long renders;   // misses that rendered a pixmap
+      unsigned long prewarms;  // pixmaps rendered for prewarm()
+      unsigned long evictions; // unused pixmaps freed to stay in the limit
+      unsigned long pixmaps;   // pixmaps in the cache
+      unsigned long memory;    // in kilobytes, see memoryUsage()
+      unsigned long render_usec[GradientTypes];
+      unsigned long render_times[GradientTypes][RenderTimeBuckets];
+    };
+
+    /*
+      Returns the counters for the specified screen.
+    */
+    static Statistics statistics(unsigned int screen);
+
+    /*
+      Returns the counters for the specified screen as human readable
+      text, one item per line.
+    */
+    static std::string statisticsReport(unsigned int screen);
+
     /*
       Returns a pixmap matching the specified texture and size on the
       specified screen.  The pixmap will be rendered if necessary.
 
+      Textures that only change along one axis (horizontal and
+      vertical gradients) are rendered once as a strip that is one
+      pixel wide or high, and that strip is returned for every size.
+      The pixmap must therefore be tiled, not copied, starting at the
+      origin of the textured area (drawTexture() does this, as does
+      using it as a window background).
+
       If old_pixmap is non-zero, PixmapCache::release(old_pixmap) will
       be called immediately after finding the requested pixmap.
     */
@@ -70,6 +132,24 @@ namespace bt {
                        unsigned int width, unsigned int height,
                        Pixmap old_pixmap = 0ul);
 
+    /*
+      Schedules the pixmap for the texture and size to be rendered
+      while the application is idle, so that a later find() does not
+      have to render it.  Prewarmed pixmaps are not referenced; they
+      stay in the cache like released pixmaps.  Pixmaps that would
+      push the screen over its cache limit are not prewarmed.
+    */
+    static void prewarm(unsigned int screen,
+                        const Texture &texture,
+                        unsigned int width, unsigned int height);
+
+    /*
+      Renders one pixmap scheduled with prewarm().  Returns true if
+      more are scheduled.  bt::Application calls this whenever there
+      are no events to process.
+    */
+    static bool renderIdle(void);
+
     /*
       Indicates that the specified pixmap is no longer needed.
       Pixmaps contained in the cache are reference counted, so you
@@ -79,7 +159,8 @@ namespace bt {
     static void release(Pixmap pixmap);
 
     /*
-      Free all unused pixmaps in the cache.
+      Free all unused pixmaps in the cache, and drop the pixmaps
+      scheduled with prewarm() that have not been rendered yet.
     */
     static void clearCache(void);
 
@@ -67,6 +67,37 @@ void bt::Texture::setColor1(const bt::Color &new_color) {
 }
 
 
+namespace bt {
+
+  // FNV-1a, one 32-bit word at a time
+  static inline void fnv(unsigned long long &hash, unsigned int value) {
+    hash ^= value;
+    hash *= 1099511628211ull;
+  }
+
+  static inline void fnv(unsigned long long &hash, const Color &color) {
+    // invalid colors have -1 components
+    fnv(hash, static_cast<unsigned int>(color.red()));
+    fnv(hash, static_cast<unsigned int>(color.green()));
+    fnv(hash, static_cast<unsigned int>(color.blue()));
+  }
+
+} // namespace bt
+
+
+unsigned long long bt::Texture::fingerprint(void) const {
+  unsigned long long hash = 14695981039346656037ull;
+  fnv(hash, c1);
+  fnv(hash, c2);
+  fnv(hash, bc);
+  fnv(hash, lc);
+  fnv(hash, sc);
+  fnv(hash, static_cast<unsigned int>(t));
+  fnv(hash, bw);
+  return hash;
+}
+
+
 void bt::Texture::setDescription(const std::string &d) {
   descr = tolower(d);
   if (descr.find("parentrelative") != std::string::npos) {
@@ -222,9 +253,11 @@ void bt::drawTexture(unsigned int screen,
   Pen pen(screen, texture.color1());
 
   if ((texture.texture() & Texture::Gradient) && pixmap) {
-    XCopyArea(pen.XDisplay(), pixmap, drawable, pen.gc(),
-              urect.x() - trect.x(), urect.y() - trect.y(),
-              urect.width(), urect.height(), urect.x(), urect.y());
+    // the pixmap may be a strip smaller than trect (see PixmapCache),
+    // so tile it from the texture origin
+    pen.setTile(pixmap, trect.x(), trect.y());
+    XFillRectangle(pen.XDisplay(), drawable, pen.gc(),
+                   urect.x(), urect.y(), urect.width(), urect.height());
     return;
   } else if (!(texture.texture() & Texture::Solid)) {
     XClearArea(pen.XDisplay(), drawable,
@@ -135,6 +135,12 @@ namespace bt {
     inline void setBorderWidth(unsigned int new_bw)
     { bw = new_bw; }
 
+    /*
+      Returns a 64-bit hash of everything compared by operator==().
+      Equal textures have equal fingerprints.
+    */
+    unsigned long long fingerprint(void) const;
+
     Texture &operator=(const Texture &tt);
     inline bool operator==(const Texture &tt) const {
       return (c1 == tt.c1 && c2 == tt.c2 && bc == tt.bc &&
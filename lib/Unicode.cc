@@ -25,7 +25,9 @@
 #include "Unicode.hh"
 
 #include <algorithm>
+#include <map>
 
+#include <ctype.h>
 #include <errno.h>
 #include <iconv.h>
 #include <locale.h>
@@ -35,108 +37,340 @@
 #  include <langinfo.h>
 #endif
 
+#if defined(SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#  define SIMD_SSE2
+#  include <emmintrin.h>
+#endif // SIMD && __GNUC__ && __SSE2__
+
 
 namespace bt {
 
   static const iconv_t invalid = reinterpret_cast<iconv_t>(-1);
   static std::string codeset;
+  static bool utf8_locale = false;
+
+  // U+FFFD REPLACEMENT CHARACTER, substituted for malformed input
+  static const Uchar replacement_character = 0xfffd;
+
+  /*
+   * Returns true if charset names UTF-8 ("UTF-8", "utf8", "UTF_8",
+   * ...).
+   */
+  static bool isUtf8(const std::string &charset) {
+    std::string name;
+    std::string::const_iterator it = charset.begin();
+    const std::string::const_iterator end = charset.end();
+    for (; it != end; ++it) {
+      if (*it == '-' || *it == '_')
+        continue;
+      name += static_cast<char>(tolower(static_cast<unsigned char>(*it)));
+    }
+    return name == "utf8";
+  }
+
+
+  /*
+   * Native UTF-8 <-> UTF-32 codec.
+   *
+   * Malformed UTF-8 (stray continuation bytes, overlong forms,
+   * surrogates, values above U+10FFFF and truncated sequences) is
+   * replaced with U+FFFD, one per maximal ill-formed subsequence as
+   * recommended by the Unicode standard.  Surrogates and values
+   * above U+10FFFF in UTF-32 input are likewise encoded as U+FFFD.
+   * Runs of ASCII are converted 16 (or 8) characters at a time when
+   * SSE2 is available.
+   */
+
+  static ustring decodeUtf8(const std::string &utf8) {
+    ustring ret;
+    if (utf8.empty())
+      return ret;
+
+    // never more characters than bytes
+    ret.resize(utf8.size());
+    const unsigned char *s =
+      reinterpret_cast<const unsigned char *>(utf8.data());
+    const unsigned char * const end = s + utf8.size();
+    Uchar *d = &ret[0];
+
+    while (s != end) {
+#ifdef SIMD_SSE2
+      while (end - s >= 16) {
+        const __m128i bytes =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        if (_mm_movemask_epi8(bytes) != 0)
+          break;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        __m128i *out = reinterpret_cast<__m128i *>(d);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+        s += 16;
+        d += 16;
+      }
+      if (s == end)
+        break;
+#endif // SIMD_SSE2
+
+      const unsigned int c = *s;
+      if (c < 0x80) {
+        *d++ = c;
+        ++s;
+        continue;
+      }
 
-  static unsigned int byte_swap(unsigned int c) {
-    wchar_t ret;
-    int x = sizeof(wchar_t);
-    char *s = reinterpret_cast<char *>(&c);
-    char *d = reinterpret_cast<char *>(&ret) + x - 1;
-    while (x-- > 0)
-      *d-- = *s++;
+      // number of continuation bytes, and the valid range of the
+      // first one (which excludes overlong forms and surrogates)
+      unsigned int count, lo = 0x80, hi = 0xbf;
+      Uchar value;
+      if (c < 0xc2) {
+        *d++ = replacement_character;
+        ++s;
+        continue;
+      } else if (c < 0xe0) {
+        count = 1;
+        value = c & 0x1f;
+      } else if (c < 0xf0) {
+        count = 2;
+        value = c & 0x0f;
+        if (c == 0xe0)
+          lo = 0xa0;
+        else if (c == 0xed)
+          hi = 0x9f;
+      } else if (c < 0xf5) {
+        count = 3;
+        value = c & 0x07;
+        if (c == 0xf0)
+          lo = 0x90;
+        else if (c == 0xf4)
+          hi = 0x8f;
+      } else {
+        *d++ = replacement_character;
+        ++s;
+        continue;
+      }
+
+      ++s;
+      unsigned int x = 0;
+      for (; x < count && s != end; ++x, ++s) {
+        if (*s < lo || *s > hi)
+          break;
+        value = (value << 6) | (*s & 0x3f);
+        lo = 0x80;
+        hi = 0xbf;
+      }
+      // a truncated sequence becomes one replacement character; the
+      // byte that ended it is decoded on its own
+      *d++ = (x == count) ? value : replacement_character;
+    }
+
+    ret.resize(d - ret.data());
     return ret;
   }
 
-  static ustring native_endian(const ustring &string) {
-    if (string.empty())
-      return string;
-    if (*string.begin() == 0x0000feff) {
-      // begins with BOM in native endian
-      return ustring(string.begin() + 1, string.end());
-    } else if (*string.begin() == 0xfffe0000) {
-      // BOM is byte swapped, convert to native endian
-      ustring ret = ustring(string.begin() + 1, string.end());
-      ustring::iterator it = ret.begin();
-      const ustring::iterator end = ret.end();
-      for (; it != end; ++it)
-        *it = byte_swap(*it);
+  static std::string encodeUtf8(const ustring &utf32) {
+    std::string ret;
+    if (utf32.empty())
       return ret;
-    } else {
-      return string;
+
+    // never more than 4 bytes per character
+    ret.resize(utf32.size() * 4);
+    const Uchar *s = utf32.data();
+    const Uchar * const end = s + utf32.size();
+    unsigned char *d = reinterpret_cast<unsigned char *>(&ret[0]);
+
+    while (s != end) {
+#ifdef SIMD_SSE2
+      while (end - s >= 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        const __m128i b =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 4));
+        const __m128i high =
+          _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi32(~0x7f));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128()))
+            != 0xffff)
+          break;
+        // all values are below 0x80, so saturation never kicks in
+        const __m128i words = _mm_packs_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(d),
+                         _mm_packus_epi16(words, words));
+        s += 8;
+        d += 8;
+      }
+      if (s == end)
+        break;
+#endif // SIMD_SSE2
+
+      Uchar c = *s++;
+      if (c < 0x80) {
+        *d++ = c;
+        continue;
+      }
+      if ((c >= 0xd800 && c <= 0xdfff) || c > 0x10ffff)
+        c = replacement_character;
+
+      if (c < 0x800) {
+        *d++ = 0xc0 | (c >> 6);
+      } else if (c < 0x10000) {
+        *d++ = 0xe0 | (c >> 12);
+        *d++ = 0x80 | ((c >> 6) & 0x3f);
+      } else {
+        *d++ = 0xf0 | (c >> 18);
+        *d++ = 0x80 | ((c >> 12) & 0x3f);
+        *d++ = 0x80 | ((c >> 6) & 0x3f);
+      }
+      *d++ = 0x80 | (c & 0x3f);
     }
+
+    ret.resize(d - reinterpret_cast<const unsigned char *>(ret.data()));
+    return ret;
   }
 
-  static ustring add_bom(const ustring &string) {
-    ustring ret;
-    ret.push_back(0x0000feff);
-    return ret + string;
+
+  /*
+   * Conversions between the locale codeset and UTF-32 go through
+   * iconv.  Opening a descriptor is expensive, so one descriptor per
+   * direction is kept open and reset before each use.  A caller takes
+   * the cached descriptor out of its slot for the duration of the
+   * conversion (opening a fresh one if another caller already holds
+   * it) and puts it back afterwards, so concurrent conversions never
+   * share a descriptor.
+   */
+  struct IconvSlot {
+    std::string to, from;
+    iconv_t cd;
+  };
+  static IconvSlot to_unicode = { "", "", invalid };
+  static IconvSlot from_unicode = { "", "", invalid };
+
+  static iconv_t takeIconv(IconvSlot &slot) {
+#ifdef __GNUC__
+    iconv_t cd = __sync_lock_test_and_set(&slot.cd, invalid);
+#else
+    iconv_t cd = slot.cd;
+    slot.cd = invalid;
+#endif // __GNUC__
+    if (cd == invalid)
+      return iconv_open(slot.to.c_str(), slot.from.c_str());
+    // back to the initial shift state
+    iconv(cd, 0, 0, 0, 0);
+    return cd;
   }
 
+  static void putIconv(IconvSlot &slot, iconv_t cd) {
+#ifdef __GNUC__
+    if (__sync_bool_compare_and_swap(&slot.cd, invalid, cd))
+      return;
+#else
+    if (slot.cd == invalid) {
+      slot.cd = cd;
+      return;
+    }
+#endif // __GNUC__
+    // somebody else returned theirs first
+    iconv_close(cd);
+  }
+
+  /*
+   * Appends the sequence that returns cd to its initial shift state
+   * (nothing for stateless codesets) to out, after the first used
+   * bytes.  Returns false if iconv fails.
+   */
+  template <typename _Target>
+  static bool flushShiftState(iconv_t cd, _Target &out, size_t &used) {
+    typedef typename _Target::value_type TargetUnit;
+
+    for (;;) {
+      char *outp = reinterpret_cast<char *>(&out[0]) + used;
+      size_t out_bytes = out.size() * sizeof(TargetUnit) - used;
+      const size_t l = iconv(cd, 0, 0, &outp, &out_bytes);
+      used = out.size() * sizeof(TargetUnit) - out_bytes;
+      if (l != (size_t) -1)
+        return true;
+      if (errno != E2BIG)
+        return false;
+      out.resize(out.size() * 2);
+    }
+  }
+
+  /*
+   * Converts in to out with iconv.  Input that cannot be converted
+   * (malformed, truncated, or not representable in the target) is
+   * skipped one source unit at a time, with a replacement unit
+   * written in its place.  Stateful targets are returned to their
+   * initial shift state before each replacement and at the end.
+   */
   template <typename _Source, typename _Target>
-  static void convert(const char *target, const char *source,
-                      const _Source &in, _Target &out) {
-    iconv_t cd = iconv_open(target, source);
+  static void convert(IconvSlot &slot, const _Source &in, _Target &out,
+                      typename _Target::value_type replacement) {
+    typedef typename _Source::value_type SourceUnit;
+    typedef typename _Target::value_type TargetUnit;
+
+    out = _Target();
+    if (in.empty())
+      return;
+
+    iconv_t cd = takeIconv(slot);
     if (cd == invalid)
       return;
 
-    char *inp =
-      reinterpret_cast<char *>
-      (const_cast<typename _Source::value_type *>(in.data()));
-    const typename _Source::size_type in_size =
-      in.size() * sizeof(typename _Source::value_type);
-    typename _Source::size_type in_bytes = in_size;
-
-    out.resize(in_size);
-
-    char *outp =
-      reinterpret_cast<char *>
-      (const_cast<typename _Target::value_type *>(out.data()));
-    typename _Target::size_type out_size =
-      out.size() * sizeof(typename _Target::value_type);
-    typename _Target::size_type out_bytes = out_size;
-
-    do {
-      size_t l = iconv(cd, &inp, &in_bytes, &outp, &out_bytes);
-
-      if (l == (size_t) -1) {
-        switch (errno) {
-        case EILSEQ:
-        case EINVAL:
-          {
-            const typename _Source::size_type off = in_size - in_bytes + 1;
-            inp =
-              reinterpret_cast<char *>
-              (const_cast<typename _Source::value_type *>(in.data()));
-            in_bytes = in_size - off;
-            break;
-          }
-        case E2BIG:
-          {
-            const typename _Target::size_type off = out_size - out_bytes;
-            out.resize(out.size() * 2);
-            out_size = out.size() * sizeof(typename _Target::value_type);
-
-            outp =
-              reinterpret_cast<char *>
-              (const_cast<typename _Target::value_type *>(out.data())) + off;
-            out_bytes = out_size - off;
-            break;
-          }
-        default:
-          perror("iconv");
-          out = _Target();
-          iconv_close(cd);
-          return;
+    char *inp = reinterpret_cast<char *>(const_cast<SourceUnit *>(in.data()));
+    size_t in_bytes = in.size() * sizeof(SourceUnit);
+
+    out.resize(in.size() + 4);
+    size_t used = 0; // in bytes
+    bool ok = true;
+
+    while (ok && in_bytes != 0) {
+      char *outp = reinterpret_cast<char *>(&out[0]) + used;
+      size_t out_bytes = out.size() * sizeof(TargetUnit) - used;
+      const size_t l = iconv(cd, &inp, &in_bytes, &outp, &out_bytes);
+      used = out.size() * sizeof(TargetUnit) - out_bytes;
+      if (l != (size_t) -1)
+        continue;
+
+      switch (errno) {
+      case E2BIG:
+        out.resize(out.size() * 2);
+        break;
+
+      case EILSEQ:
+      case EINVAL:
+        // skip the offending unit, or the truncated tail
+        {
+          const size_t skip =
+            (errno == EINVAL) ? in_bytes : sizeof(SourceUnit);
+          inp += skip;
+          in_bytes -= skip;
         }
+        ok = flushShiftState(cd, out, used);
+        if (!ok)
+          break;
+        if (out.size() * sizeof(TargetUnit) - used < sizeof(TargetUnit))
+          out.resize(out.size() * 2);
+        out[used / sizeof(TargetUnit)] = replacement;
+        used += sizeof(TargetUnit);
+        break;
+
+      default:
+        ok = false;
+        break;
       }
-    } while (in_bytes != 0);
+    }
 
-    out.resize((out_size - out_bytes) / sizeof(typename _Target::value_type));
-    iconv_close(cd);
+    if (ok)
+      ok = flushShiftState(cd, out, used);
+
+    if (ok) {
+      out.resize(used / sizeof(TargetUnit));
+    } else {
+      perror("iconv");
+      out = _Target();
+    }
+    putIconv(slot, cd);
   }
 
 } // namespace bt
@@ -166,29 +400,41 @@ bool bt::hasUnicode() {
   }
 #endif // HAVE_NL_LANGINFO
 
-  struct {
-    const char *to;
-    const char *from;
-  } conversions[] = {
-    { "UTF-32", codeset.c_str() },
-    { "UTF-32", "UTF-8" },
-    { "UTF-8", "UTF-32" },
-    { codeset.c_str(), "UTF-32" },
-  };
-  static const int conversions_count = 4;
+  done = true;
 
-  for (int x = 0; x < conversions_count; ++x) {
-    iconv_t cd = iconv_open(conversions[x].to, conversions[x].from);
+  utf8_locale = isUtf8(codeset);
+  if (utf8_locale) {
+    // handled entirely by the native codec
+    return has_unicode;
+  }
 
-    if (cd == invalid) {
-      has_unicode = false;
-      break;
-    }
+  // UTF-32 in native byte order, which avoids byte order marks
+  const Uchar one = 1;
+  const std::string utf32 =
+    (*reinterpret_cast<const unsigned char *>(&one) == 1)
+    ? "UTF-32LE"
+    : "UTF-32BE";
+
+  to_unicode.to = utf32;
+  to_unicode.from = codeset;
+  from_unicode.to = codeset;
+  from_unicode.from = utf32;
+
+  // open both descriptors now; they stay cached for later conversions
+  iconv_t cd = takeIconv(to_unicode);
+  if (cd == invalid) {
+    has_unicode = false;
+    return has_unicode;
+  }
+  putIconv(to_unicode, cd);
 
-    iconv_close(cd);
+  cd = takeIconv(from_unicode);
+  if (cd == invalid) {
+    has_unicode = false;
+    return has_unicode;
   }
+  putIconv(from_unicode, cd);
 
-  done = true;
   return has_unicode;
 }
 
@@ -200,9 +446,10 @@ bt::ustring bt::toUnicode(const std::string &string) {
     std::copy(string.begin(), string.end(), ret.begin());
     return ret;
   }
-  ret.reserve(string.size());
-  convert("UTF-32", codeset.c_str(), string, ret);
-  return native_endian(ret);
+  if (utf8_locale)
+    return decodeUtf8(string);
+  convert(to_unicode, string, ret, replacement_character);
+  return ret;
 }
 
 std::string bt::toLocale(const bt::ustring &string) {
@@ -213,25 +460,127 @@ std::string bt::toLocale(const bt::ustring &string) {
     std::copy(string.begin(), string.end(), ret.begin());
     return ret;
   }
-  ret.reserve(string.size());
-  convert(codeset.c_str(), "UTF-32", add_bom(string), ret);
+  if (utf8_locale)
+    return encodeUtf8(string);
+  convert(from_unicode, string, ret, '?');
   return ret;
 }
 
 std::string bt::toUtf8(const bt::ustring &utf32) {
-  std::string ret;
   if (!hasUnicode())
-    return ret;
-  ret.reserve(utf32.size());
-  convert("UTF-8", "UTF-32", add_bom(utf32), ret);
-  return ret;
+    return std::string();
+  return encodeUtf8(utf32);
 }
 
 bt::ustring bt::toUtf32(const std::string &utf8) {
-  ustring ret;
   if (!hasUnicode())
-    return ret;
-  ret.reserve(utf8.size());
-  convert("UTF-32", "UTF-8", utf8, ret);
-  return native_endian(ret);
+    return ustring();
+  return decodeUtf8(utf8);
 }
+
+
+namespace bt {
+
+  struct InternedStringRep {
+    std::string utf8;
+    unsigned int refs;
+  };
+
+  struct InternedStringLess {
+    inline bool operator()(const std::string *a, const std::string *b) const
+    { return *a < *b; }
+  };
+
+  typedef std::map<const std::string *,
+                   InternedStringRep *,
+                   InternedStringLess> InternedStringTable;
+
+  /*
+    Allocated on first use and never freed, so that strings in static
+    objects can still be released during exit.
+  */
+  static InternedStringTable *interned_strings = 0;
+
+  static void releaseRep(InternedStringRep *rep) {
+    if (!rep || --rep->refs != 0)
+      return;
+    interned_strings->erase(&rep->utf8);
+    delete rep;
+  }
+
+} // namespace bt
+
+
+bt::InternedString bt::InternedString::intern(const std::string &utf8) {
+  if (utf8.empty())
+    return InternedString();
+
+  if (!interned_strings)
+    interned_strings = new InternedStringTable;
+
+  InternedStringTable::iterator it = interned_strings->find(&utf8);
+  if (it != interned_strings->end()) {
+    ++it->second->refs;
+    return InternedString(it->second);
+  }
+
+  InternedStringRep *rep = new InternedStringRep;
+  rep->utf8 = utf8;
+  rep->refs = 1;
+  interned_strings->insert(InternedStringTable::value_type(&rep->utf8, rep));
+  return InternedString(rep);
+}
+
+
+bt::InternedString::InternedString(const ustring &string)
+  : rep(0)
+{ *this = intern(encodeUtf8(string)); }
+
+
+bt::InternedString::InternedString(const InternedString &other)
+  : rep(other.rep) {
+  if (rep)
+    ++rep->refs;
+}
+
+
+bt::InternedString::~InternedString(void)
+{ releaseRep(rep); }
+
+
+bt::InternedString
+bt::InternedString::fromUtf8(const std::string &utf8) {
+  std::string::const_iterator it = utf8.begin();
+  const std::string::const_iterator end = utf8.end();
+  for (; it != end; ++it) {
+    if (static_cast<unsigned char>(*it) >= 0x80) {
+      // not plain ASCII, replace anything malformed
+      return intern(encodeUtf8(decodeUtf8(utf8)));
+    }
+  }
+  return intern(utf8);
+}
+
+
+unsigned long bt::InternedString::count(void)
+{ return interned_strings ? interned_strings->size() : 0ul; }
+
+
+bt::InternedString &
+bt::InternedString::operator=(const InternedString &other) {
+  if (other.rep)
+    ++other.rep->refs;
+  releaseRep(rep);
+  rep = other.rep;
+  return *this;
+}
+
+
+const std::string &bt::InternedString::utf8(void) const {
+  static const std::string empty_string;
+  return rep ? rep->utf8 : empty_string;
+}
+
+
+bt::ustring bt::InternedString::unicode(void) const
+{ return rep ? decodeUtf8(rep->utf8) : ustring(); }
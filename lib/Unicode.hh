@@ -66,6 +66,57 @@ namespace bt
    */
   ustring toUtf32(const std::string &utf8);
 
+  struct InternedStringRep;
+
+  /*
+   * Immutable, reference counted Unicode string stored as UTF-8.
+   * Equal strings share a single copy, so copying and comparing are
+   * cheap; the UTF-32 form is decoded on demand and not kept.  Used
+   * for window titles, menu labels and workspace names.
+   */
+  class InternedString {
+  public:
+    inline InternedString(void)
+      : rep(0)
+    { }
+    InternedString(const ustring &string);
+    InternedString(const InternedString &other);
+    ~InternedString(void);
+
+    /*
+     * Returns the string for the UTF-8 in utf8.  Malformed sequences
+     * are replaced with U+FFFD.
+     */
+    static InternedString fromUtf8(const std::string &utf8);
+
+    /*
+     * Returns the number of distinct strings currently interned.
+     */
+    static unsigned long count(void);
+
+    InternedString &operator=(const InternedString &other);
+
+    inline bool operator==(const InternedString &other) const
+    { return rep == other.rep; }
+    inline bool operator!=(const InternedString &other) const
+    { return rep != other.rep; }
+
+    inline bool empty(void) const
+    { return rep == 0; }
+
+    const std::string &utf8(void) const;
+    ustring unicode(void) const;
+
+  private:
+    explicit InternedString(InternedStringRep *r)
+      : rep(r)
+    { }
+
+    static InternedString intern(const std::string &utf8);
+
+    InternedStringRep *rep;
+  };
+
 } // namespace bt
 
 /*
@@ -176,6 +176,10 @@ void BlackboxResource::load(Blackbox& blackbox) {
     res.read("session.opaqueResize",
              "Session.OpaqueResize",
              true);
+  render_cache =
+    res.read("session.renderCache",
+             "Session.RenderCache",
+             false);
   full_max =
     res.read("session.fullMaximization",
              "Session.FullMaximization",
@@ -307,6 +311,7 @@ void BlackboxResource::save(Blackbox& blackbox) {
 
   res.write("session.opaqueMove", opaque_move);
   res.write("session.opaqueResize", opaque_resize);
+  res.write("session.renderCache", render_cache);
   res.write("session.fullMaximization", full_max);
   res.write("session.focusNewWindows", focus_new_windows);
   res.write("session.focusLastWindow", focus_last_window_on_workspace);
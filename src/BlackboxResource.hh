@@ -82,6 +82,7 @@ private:
   bool change_workspace_with_mouse_wheel;
   bool shade_window_with_mouse_wheel;
   bool toolbar_actions_with_mouse_wheel;
+  bool render_cache;
   unsigned int edge_snap_threshold;
   unsigned int window_snap_threshold;
 
@@ -161,6 +162,11 @@ public:
   inline void setOpaqueResize(bool b = true)
   { opaque_resize = b; }
 
+  inline bool renderCache(void) const
+  { return render_cache; }
+  inline void setRenderCache(bool b = true)
+  { render_cache = b; }
+
   inline bool fullMaximization(void) const
   { return full_max; }
   inline void setFullMaximization(bool b = true)
@@ -32,7 +32,7 @@ Rootmenu::Rootmenu(bt::Application &app, unsigned int screen, BScreen *bscreen)
   : bt::Menu(app, screen), _bscreen(bscreen) { }
 
 
-void Rootmenu::insertFunction(const bt::ustring &label,
+void Rootmenu::insertFunction(const bt::InternedString &label,
                               unsigned int function,
                               const std::string &exec,
                               unsigned int id,
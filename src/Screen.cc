@@ -39,6 +39,7 @@
 #include "Workspace.hh"
 #include "Workspacemenu.hh"
 
+#include <Image.hh>
 #include <Pen.hh>
 #include <PixmapCache.hh>
 #include <Unicode.hh>
@@ -251,6 +252,7 @@ BScreen::BScreen(Blackbox *bb, unsigned int scrn) :
   }
 
   InitMenu();
+  prewarmMenus();
 
   /*
     ewmh requires the window manager to set a property on a window it creates
@@ -436,8 +438,10 @@ BScreen::~BScreen(void) {
 
   bt::PixmapCache::release(geom_pixmap);
 
-  if (geom_window != None)
+  if (geom_window != None) {
+    bt::Pen::releaseDrawable(geom_window);
     XDestroyWindow(_blackbox->XDisplay(), geom_window);
+  }
   if (empty_window != None)
     XDestroyWindow(_blackbox->XDisplay(), empty_window);
 
@@ -551,8 +555,37 @@ void BScreen::rereadMenu(void) {
 }
 
 
+/*
+  Schedules the menu pixmaps for the current style to be rendered
+  while idle, so the first popup of each menu does not render them.
+  Windows, the toolbar and the slit render theirs when reconfigured.
+  Blackbox::reconfigure() calls this once the caches are cleared,
+  since clearing drops scheduled renders.
+*/
+void BScreen::prewarmMenus(void) {
+  _rootmenu->prewarm();
+  _workspacemenu->prewarm();
+  configmenu->prewarm();
+}
+
+
 void BScreen::LoadStyle(void) {
-  _resource.loadStyle(this, _blackbox->resource().styleFilename());
+  const char *style = _blackbox->resource().styleFilename();
+
+  // cached renders are only valid for this version of the style file
+  std::string stamp = style;
+  struct stat st;
+  if (stat(style, &st) == 0) {
+    char buf[32];
+    sprintf(buf, ":%lu", static_cast<unsigned long>(st.st_mtime));
+    stamp += buf;
+  }
+  bt::Image::setRenderCache(_blackbox->resource().renderCache(), stamp);
+
+  // allocate the style's colors in one batch
+  bt::Color::deferAllocation();
+  _resource.loadStyle(this, style);
+  bt::Color::allocateDeferred();
 
   if (! _resource.rootCommand().empty())
     bt::bexec(_resource.rootCommand(), screen_info.displayString());
@@ -1353,13 +1386,13 @@ void BScreen::restackWindows(void) {
 void BScreen::propagateWindowName(const BlackboxWindow * const win) {
   if (win->isIconic()) {
     _iconmenu->changeItem(win->windowNumber(),
-                          bt::ellideText(win->iconTitle(), 60,
+                          bt::ellideText(win->iconTitle().unicode(), 60,
                                          bt::toUnicode("...")));
   } else if (win->workspace() != bt::BSENTINEL) {
     Workspace *workspace = findWorkspace(win->workspace());
     assert(workspace != 0);
     workspace->menu()->changeItem(win->windowNumber(),
-                                  bt::ellideText(win->title(), 60,
+                                  bt::ellideText(win->title().unicode(), 60,
                                                  bt::toUnicode("...")));
   }
 
@@ -2112,7 +2145,7 @@ void BScreen::updateDesktopNamesHint(void) const {
   WorkspaceList::const_iterator it = workspacesList.begin();
   const WorkspaceList::const_iterator end = workspacesList.end();
   for (; it != end; ++it)
-    names.push_back((*it)->name());
+    names.push_back((*it)->name().unicode());
   _blackbox->ewmh().setDesktopNames(screen_info.rootWindow(), names);
 }
 
@@ -2166,8 +2199,9 @@ void BScreen::readDesktopNames(void) {
   const WorkspaceList::iterator wend = workspacesList.end();
 
   for (; wit != wend && it != end; ++wit, ++it) {
-    if ((*wit)->name() != *it)
-      (*wit)->setName(*it);
+    const bt::InternedString name(*it);
+    if ((*wit)->name() != name)
+      (*wit)->setName(name);
   }
 
   if (names.size() < workspacesList.size())
@@ -2607,8 +2641,8 @@ void BScreen::addIcon(BlackboxWindow *win) {
     }
   }
 
-  const bt::ustring s =
-    bt::ellideText(win->iconTitle(), 60, bt::toUnicode("..."));
+  const bt::InternedString s =
+    bt::ellideText(win->iconTitle().unicode(), 60, bt::toUnicode("..."));
   int id = _iconmenu->insertItem(s);
   _blackbox->ewmh().setWMVisibleIconName(win->clientWindow(), s);
   win->setWindowNumber(id);
@@ -214,6 +214,7 @@ public:
   void propagateWindowName(const BlackboxWindow * const win);
 
   void reconfigure(void);
+  void prewarmMenus(void);
   void toggleFocusModel(FocusModel model);
   void rereadMenu(void);
   void shutdown(void);
@@ -29,6 +29,7 @@
 #include "Toolbar.hh"
 
 #include <Menu.hh>
+#include <PixmapCache.hh>
 #include <Resource.hh>
 
 #include <assert.h>
@@ -115,17 +116,20 @@ void ScreenResource::save(bt::Resource& res, BScreen* screen) {
   sprintf(rc_string, "session.screen%u.workspaces", number);
   res.write(rc_string, workspace_count);
 
-  std::vector<bt::ustring>::const_iterator it = workspace_names.begin(),
-                                          end = workspace_names.end();
-  bt::ustring save_string = *it++;
+  std::vector<bt::InternedString>::const_iterator
+    it = workspace_names.begin(), end = workspace_names.end();
+  bt::ustring save_string = (it++)->unicode();
   for (; it != end; ++it) {
     save_string += ',';
-    save_string += *it;
+    save_string += it->unicode();
   }
 
   sprintf(rc_string, "session.screen%u.workspaceNames", number);
   res.write(rc_string, bt::toLocale(save_string).c_str());
 
+  sprintf(rc_string, "session.screen%u.pixmapCacheLimit", number);
+  res.write(rc_string, bt::PixmapCache::cacheLimit(number));
+
   // these options can not be modified at runtime currently
 
   sprintf(rc_string, "session.screen%u.toolbar.widthPercent", number);
@@ -220,6 +224,13 @@ void ScreenResource::load(bt::Resource& res, unsigned int screen) {
   sprintf(class_lookup, "Session.screen%u.Workspaces", screen);
   workspace_count = res.read(name_lookup, class_lookup, 4);
 
+  // in kilobytes
+  sprintf(name_lookup,  "session.screen%u.pixmapCacheLimit", screen);
+  sprintf(class_lookup, "Session.screen%u.PixmapCacheLimit", screen);
+  const unsigned long cache_limit =
+    res.read(name_lookup, class_lookup, bt::PixmapCache::cacheLimit(screen));
+  bt::PixmapCache::setCacheLimit(screen, cache_limit);
+
   if (! workspace_names.empty())
     workspace_names.clear();
 
@@ -536,16 +547,18 @@ void ScreenResource::loadStyle(BScreen* screen, const std::string& style) {
     _slitStyle.slit = flat_black;
 }
 
-const bt::ustring ScreenResource::workspaceName(unsigned int i) const {
+const bt::InternedString &
+ScreenResource::workspaceName(unsigned int i) const {
   // handle both requests for new workspaces beyond what we started with
   // and for those that lack a name
+  static const bt::InternedString unnamed;
   if (i > workspace_count || i >= workspace_names.size())
-    return bt::ustring();
+    return unnamed;
   return workspace_names[i];
 }
 
 void ScreenResource::setWorkspaceName(unsigned int i,
-                                      const bt::ustring &name) {
+                                      const bt::InternedString &name) {
     if (i >= workspace_names.size()) {
         workspace_names.reserve(i + 1);
         workspace_names.insert(workspace_names.begin() + i, name);
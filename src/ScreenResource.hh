@@ -106,8 +106,8 @@ public:
   inline void setWorkspaceCount(unsigned int w)
   { workspace_count = w; }
 
-  const bt::ustring workspaceName(unsigned int i) const;
-  void setWorkspaceName(unsigned int w, const bt::ustring &name);
+  const bt::InternedString &workspaceName(unsigned int i) const;
+  void setWorkspaceName(unsigned int w, const bt::InternedString &name);
 
   inline const std::string& rootCommand(void) const
   { return root_command; }
@@ -121,7 +121,7 @@ private:
   SlitStyle _slitStyle;
 
   unsigned int workspace_count;
-  std::vector<bt::ustring> workspace_names;
+  std::vector<bt::InternedString> workspace_names;
   std::string root_command;
 };
 
@@ -197,7 +197,7 @@ static void print_entity(StackEntity *entity)
   if (win) {
     fprintf(stderr, gettext("  0x%lx: window 0x%lx %p '%s'\n"),
             win->windowID(), win->clientWindow(), win,
-            bt::toLocale(win->title()).c_str());
+            bt::toLocale(win->title().unicode()).c_str());
   } else if (entity) {
     fprintf(stderr, gettext("  0x%lx: %p unknown entity\n"),
             entity->windowID(), entity);
@@ -326,6 +326,9 @@ void Toolbar::reconfigure(void) {
                             border_width + style.frame_margin,
                             window_label_w,
                             style.label_height);
+  // the font may have changed, ellide the title again
+  window_title = visible_window_title = bt::InternedString();
+  visible_window_title_width = 0;
   // previous window button
   frame.pw_rect.setRect(border_width + (style.frame_margin * 5)
                         + (style.button_width * 2) + label_w
@@ -487,16 +490,23 @@ void Toolbar::redrawWindowLabel(void) {
   if (! foc || foc->screen() != _screen)
     return;
 
+  if (foc->title() != window_title
+      || u.width() != visible_window_title_width) {
+    window_title = foc->title();
+    visible_window_title_width = u.width();
+    visible_window_title =
+      bt::ellideText(window_title.unicode(), u.width(), bt::toUnicode("..."),
+                     _screen->screenNumber(), style.font);
+  }
+
   bt::Pen pen(_screen->screenNumber(), style.wlabel_text);
   bt::drawText(style.font, pen, frame.window_label, u,
-               style.alignment,
-               bt::ellideText(foc->title(), u.width(), bt::toUnicode("..."),
-                              _screen->screenNumber(), style.font));
+               style.alignment, visible_window_title);
 }
 
 
 void Toolbar::redrawWorkspaceLabel(void) {
-  const bt::ustring &name =
+  const bt::InternedString &name =
     _screen->resource().workspaceName(_screen->currentWorkspace());
   const ToolbarStyle &style = _screen->resource().toolbarStyle();
 
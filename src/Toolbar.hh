@@ -58,6 +58,10 @@ private:
   std::string new_workspace_name;
   size_t new_name_pos;
 
+  // the focused window's title, and as ellided to the window label
+  bt::InternedString window_title, visible_window_title;
+  unsigned int visible_window_title_width;
+
   void redrawPrevWorkspaceButton(bool pressed = False);
   void redrawNextWorkspaceButton(bool pressed = False);
   void redrawPrevWindowButton(bool preseed = False);
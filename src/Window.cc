@@ -34,6 +34,7 @@
 #include "Workspace.hh"
 #include "blackbox.hh"
 
+#include <Image.hh>
 #include <Pen.hh>
 #include <PixmapCache.hh>
 #include <Unicode.hh>
@@ -518,8 +519,8 @@ static bt::Rect restoreGravity(const bt::Rect &rect,
 }
 
 
-static bt::ustring readWMName(Blackbox *blackbox, Window window) {
-  bt::ustring name;
+static bt::InternedString readWMName(Blackbox *blackbox, Window window) {
+  bt::InternedString name;
 
   if (!blackbox->ewmh().readWMName(window, name) || name.empty()) {
     XTextProperty text_prop;
@@ -539,8 +540,9 @@ static bt::ustring readWMName(Blackbox *blackbox, Window window) {
 }
 
 
-static bt::ustring readWMIconName(Blackbox *blackbox, Window window) {
-  bt::ustring name;
+static bt::InternedString readWMIconName(Blackbox *blackbox,
+                                         Window window) {
+  bt::InternedString name;
 
   if (!blackbox->ewmh().readWMIconName(window, name) || name.empty()) {
     XTextProperty text_prop;
@@ -551,9 +553,6 @@ static bt::ustring readWMIconName(Blackbox *blackbox, Window window) {
     }
   }
 
-  if (name.empty())
-    return bt::ustring();
-
   return name;
 }
 
@@ -1308,6 +1307,8 @@ BlackboxWindow::~BlackboxWindow(void) {
     _screen->hideGeometry();
     XUngrabPointer(blackbox->XDisplay(), blackbox->XTime());
   }
+  if (client.state.resizing)
+    bt::Image::setInteractiveResize(false);
 
   delete timer;
 
@@ -1777,9 +1778,10 @@ void BlackboxWindow::positionButtons(bool redecorate_label) {
                               frame.ulabel);
     }
 
-    const bt::ustring ellided =
-      bt::ellideText(client.title, frame.label_w, bt::toUnicode("..."),
-                     _screen->screenNumber(), style.font);
+    const bt::InternedString ellided =
+      bt::ellideText(client.title.unicode(), frame.label_w,
+                     bt::toUnicode("..."), _screen->screenNumber(),
+                     style.font);
 
     if (ellided != client.visible_title) {
       client.visible_title = ellided;
@@ -2343,7 +2345,7 @@ void BlackboxWindow::show(void) {
   XTranslateCoordinates(blackbox->XDisplay(), client.window,
                         _screen->screenInfo().rootWindow(),
                         0, 0, &real_x, &real_y, &child);
-  fprintf(stderr, gettext("%s -- assumed: (%d, %d), real: (%d, %d)\n"), title().c_str(),
+  fprintf(stderr, gettext("%s -- assumed: (%d, %d), real: (%d, %d)\n"), title().utf8().c_str(),
           client.rect.left(), client.rect.top(), real_x, real_y);
   assert(client.rect.left() == real_x && client.rect.top() == real_y);
 #endif
@@ -3425,11 +3427,14 @@ void BlackboxWindow::propertyNotifyEvent(const XPropertyEvent * const event) {
   }
 
   case XA_WM_NAME: {
-    client.title = ::readWMName(blackbox, client.window);
+    const bt::InternedString title = ::readWMName(blackbox, client.window);
+    if (title == client.title)
+      break; // unchanged, nothing to redraw
+    client.title = title;
 
     client.visible_title =
-      bt::ellideText(client.title, frame.label_w, bt::toUnicode("..."),
-                     _screen->screenNumber(),
+      bt::ellideText(client.title.unicode(), frame.label_w,
+                     bt::toUnicode("..."), _screen->screenNumber(),
                      _screen->resource().windowStyle().font);
     blackbox->ewmh().setWMVisibleName(client.window, client.visible_title);
 
@@ -4124,6 +4129,7 @@ void BlackboxWindow::startResize(Window window) {
                GrabModeAsync, GrabModeAsync, None, cursor, blackbox->XTime());
 
   client.state.resizing = true;
+  bt::Image::setInteractiveResize(true);
 
   frame.changing = constrain(frame.rect, frame.margin, client.wmnormal,
                              Corner(frame.corner));
@@ -4264,6 +4270,7 @@ void BlackboxWindow::finishResize() {
   }
 
   client.state.resizing = false;
+  bt::Image::setInteractiveResize(false);
 
   XUngrabPointer(blackbox->XDisplay(), blackbox->XTime());
 
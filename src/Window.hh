@@ -159,7 +159,7 @@ class BlackboxWindow : public StackEntity, public bt::TimeoutHandler,
     Window transient_for;             // which window are we a transient for?
     BlackboxWindowList transientList; // which windows are our transients?
 
-    bt::ustring title, visible_title, icon_title;
+    bt::InternedString title, visible_title, icon_title;
 
     bt::Rect rect, premax;
 
@@ -335,9 +335,9 @@ public:
   inline Window clientWindow(void) const
   { return client.window; }
 
-  inline const bt::ustring &title(void) const
+  inline const bt::InternedString &title(void) const
   { return client.title; }
-  inline const bt::ustring &iconTitle(void) const
+  inline const bt::InternedString &iconTitle(void) const
   { return client.icon_title.empty() ? client.title : client.icon_title; }
 
   inline unsigned int workspace(void) const
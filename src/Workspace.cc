@@ -46,12 +46,12 @@ Workspace::Workspace(BScreen *scrn, unsigned int i) {
 }
 
 
-const bt::ustring Workspace::name(void) const
+const bt::InternedString &Workspace::name(void) const
 { return _screen->resource().workspaceName(_id); }
 
 
-void Workspace::setName(const bt::ustring &new_name) {
-  bt::ustring the_name;
+void Workspace::setName(const bt::InternedString &new_name) {
+  bt::InternedString the_name;
 
   if (! new_name.empty()) {
     the_name = new_name;
@@ -82,7 +82,7 @@ void Workspace::addWindow(BlackboxWindow *win) {
   }
 
   const bt::ustring s =
-    bt::ellideText(win->title(), 60, bt::toUnicode("..."));
+    bt::ellideText(win->title().unicode(), 60, bt::toUnicode("..."));
   int wid = clientmenu->insertItem(s);
   win->setWindowNumber(wid);
 }
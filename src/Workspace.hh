@@ -46,8 +46,8 @@ public:
   inline unsigned int id(void) const
   { return _id; }
 
-  const bt::ustring name(void) const;
-  void setName(const bt::ustring &new_name);
+  const bt::InternedString &name(void) const;
+  void setName(const bt::InternedString &new_name);
 
   void addWindow(BlackboxWindow *win);
   void removeWindow(BlackboxWindow *win);
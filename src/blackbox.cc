@@ -32,6 +32,7 @@
 #include <PixmapCache.hh>
 #include <Util.hh>
 
+#include <X11/Xatom.h>
 #include <X11/Xresource.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -75,7 +76,7 @@ void Blackbox::reload_rc(void) {
 }
 
 void Blackbox::init_icccm(void) {
-  const char* atoms[13] = {
+  const char* atoms[14] = {
     "MANAGER",
     "_MOTIF_WM_HINTS",
     "SM_CLIENT_ID",
@@ -88,10 +89,11 @@ void Blackbox::init_icccm(void) {
     "WM_SAVE_YOURSELF",
     "WM_STATE",
     "WM_TAKE_FOCUS",
-    "WM_WINDOW_ROLE"
+    "WM_WINDOW_ROLE",
+    "_BLACKBOX_PIXMAP_CACHE"
   };
-  Atom atoms_return[13];
-  XInternAtoms(XDisplay(), const_cast<char **>(atoms), 13, false, atoms_return);
+  Atom atoms_return[14];
+  XInternAtoms(XDisplay(), const_cast<char **>(atoms), 14, false, atoms_return);
   xa_manager = atoms_return[0];
   motif_wm_hints = atoms_return[1];
   xa_sm_client_id = atoms_return[2];
@@ -105,6 +107,7 @@ void Blackbox::init_icccm(void) {
   xa_wm_state = atoms_return[10];
   xa_wm_take_focus = atoms_return[11];
   xa_wm_window_role = atoms_return[12];
+  xa_blackbox_pixmap_cache = atoms_return[13];
 
   _ewmh = new bt::EWMH(display());
 }
@@ -376,7 +379,50 @@ bool Blackbox::process_signal(int sig) {
 }
 
 
-void Blackbox::timeout(bt::Timer *) {
+/*
+  Publishes the pixmap cache statistics of each screen as text in the
+  _BLACKBOX_PIXMAP_CACHE property on its root window, e.g. for
+  'xprop -root _BLACKBOX_PIXMAP_CACHE'.  Nothing is sent while the
+  cache is idle.
+*/
+void Blackbox::publishCacheStatistics(void) {
+  unsigned long lookups = 0ul;
+  for (unsigned int i = 0; i < screen_list_count; ++i) {
+    const bt::PixmapCache::Statistics stats =
+      bt::PixmapCache::statistics(screen_list[i]->screenNumber());
+    lookups += stats.hits + stats.misses;
+  }
+  const bt::Font::Statistics font_stats = bt::Font::statistics();
+  lookups += font_stats.hits + font_stats.misses;
+  if (lookups == published_lookups)
+    return;
+  published_lookups = lookups;
+
+  char line[128];
+  const unsigned long font_lookups = font_stats.hits + font_stats.misses;
+  sprintf(line, "text extents: hits %lu, misses %lu (%lu%%), %lu strings\n",
+          font_stats.hits, font_stats.misses,
+          font_lookups ? (font_stats.hits * 100ul) / font_lookups : 0ul,
+          font_stats.entries);
+
+  for (unsigned int i = 0; i < screen_list_count; ++i) {
+    const std::string report =
+      bt::PixmapCache::statisticsReport(screen_list[i]->screenNumber())
+      + line;
+    XChangeProperty(XDisplay(), screen_list[i]->screenInfo().rootWindow(),
+                    xa_blackbox_pixmap_cache, XA_STRING, 8, PropModeReplace,
+                    reinterpret_cast<const unsigned char *>(report.c_str()),
+                    report.length());
+  }
+}
+
+
+void Blackbox::timeout(bt::Timer *t) {
+  if (t == stats_timer) {
+    publishCacheStatistics();
+    return;
+  }
+
   XrmDatabase new_blackboxrc = (XrmDatabase) 0;
 
   std::string style = "session.styleFile: ";
@@ -399,6 +445,9 @@ void Blackbox::timeout(bt::Timer *) {
   bt::Color::clearCache();
   bt::Font::clearCache();
   bt::PixmapCache::clearCache();
+
+  std::for_each(screen_list, screen_list + screen_list_count,
+                std::mem_fun(&BScreen::prewarmMenus));
 }
 
 
@@ -459,10 +508,21 @@ Blackbox::Blackbox(char **m_argv, int m_argc, const char *dpy_name,
 
   timer = new bt::Timer(this, this);
   timer->setTimeout(0l);
+
+  stats_timer = new bt::Timer(this, this);
+  stats_timer->setTimeout(10000l);
+  stats_timer->recurring(true);
+  stats_timer->start();
+  published_lookups = ~0ul;
+  publishCacheStatistics();
 }
 
 
 Blackbox::~Blackbox(void) {
+  for (unsigned int i = 0; i < screen_list_count; ++i)
+    XDeleteProperty(XDisplay(), screen_list[i]->screenInfo().rootWindow(),
+                    xa_blackbox_pixmap_cache);
+
   std::for_each(screen_list, screen_list + screen_list_count,
                 bt::PointerAssassin());
 
@@ -471,6 +531,7 @@ Blackbox::~Blackbox(void) {
                 bt::PointerAssassin());
 
   delete timer;
+  delete stats_timer;
   delete _ewmh;
 }
 
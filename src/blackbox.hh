@@ -74,6 +74,8 @@ private:
   BlackboxWindow *focused_window;
 
   bt::Timer *timer;
+  bt::Timer *stats_timer;
+  unsigned long published_lookups;
 
   typedef std::list<MenuTimestamp*> MenuTimestampList;
   MenuTimestampList menuTimestamps;
@@ -84,7 +86,8 @@ private:
   Atom xa_manager, motif_wm_hints, xa_sm_client_id, xa_wm_change_state,
        xa_wm_client_leader, xa_wm_colormap_notify, xa_wm_colormap_windows,
        xa_wm_delete_window, xa_wm_protocols, xa_wm_save_yourself,
-       xa_wm_state, xa_wm_take_focus, xa_wm_window_role;
+       xa_wm_state, xa_wm_take_focus, xa_wm_window_role,
+       xa_blackbox_pixmap_cache;
 
   void load_rc(void);
   void save_rc(void);
@@ -93,6 +96,7 @@ private:
   void init_icccm(void);
 
   void updateActiveWindow() const;
+  void publishCacheStatistics(void);
 
   // reimplemented virtual functions
   void shutdown(void);
@@ -0,0 +1,246 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; -*-
+// colors.cc for Blackbox - an X11 Window manager
+// Copyright (c) 2001 - 2005 Sean 'Shaleh' Perry <shaleh@debian.org>
+// Copyright (c) 1997 - 2000, 2002 - 2005
+//         Bradley T Hughes <bhughes at trolltech.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+/*
+  Benchmark for allocating the colors of a style on a PseudoColor
+  screen.
+
+  The colors of every style in STYLEDIR are allocated one at a time,
+  and in one batch with Color::deferAllocation(), followed by the
+  Color::clearCache() that Blackbox::reconfigure() does after loading
+  a style.  Both are timed, best of several runs.  The test fails if
+  drawing with the batched colors after the clear still needs server
+  requests, i.e. if the clear freed them.
+
+  This needs an X server whose default visual has a writable colormap,
+  e.g. Xvfb -screen 0 1024x768x8.  Without one, the test is skipped.
+*/
+
+#include "Color.hh"
+#include "Display.hh"
+
+#include <X11/Xlib.h>
+
+#include <dirent.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifndef STYLEDIR
+#  define STYLEDIR "../data/styles"
+#endif
+
+
+namespace {
+
+  const unsigned int runs = 5u;
+
+  struct Style {
+    std::string name;
+    std::vector<std::string> colors;
+  };
+
+  std::string lowercase(std::string str) {
+    for (std::string::size_type i = 0; i < str.length(); ++i)
+      str[i] = tolower(static_cast<unsigned char>(str[i]));
+    return str;
+  }
+
+  std::string trim(const std::string &str) {
+    const std::string::size_type first = str.find_first_not_of(" \t");
+    if (first == std::string::npos)
+      return std::string();
+    const std::string::size_type last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+  }
+
+  // the values of every resource in the style named like a color
+  bool readStyle(const std::string &path, Style &style) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file)
+      return false;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+      const std::string str = line;
+      const std::string::size_type colon = str.find(':');
+      if (str[0] == '!' || colon == std::string::npos)
+        continue;
+      if (lowercase(str.substr(0, colon)).find("color") == std::string::npos)
+        continue;
+      const std::string value = trim(str.substr(colon + 1));
+      if (!value.empty())
+        style.colors.push_back(value);
+    }
+    fclose(file);
+    return !style.colors.empty();
+  }
+
+  std::vector<Style> readStyles(const std::string &dir) {
+    std::vector<Style> styles;
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+      return styles;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != 0) {
+      Style style;
+      style.name = entry->d_name;
+      if (style.name[0] == '.' || style.name.find('.') != std::string::npos)
+        continue; // Makefile.am and the like
+      if (readStyle(dir + "/" + style.name, style))
+        styles.push_back(style);
+    }
+    closedir(d);
+    return styles;
+  }
+
+  long elapsed(const ::timeval &start, const ::timeval &end) {
+    return ((end.tv_sec - start.tv_sec) * 1000000l
+            + (end.tv_usec - start.tv_usec));
+  }
+
+  void loadColors(const bt::Display &display, const Style &style,
+                  std::vector<bt::Color> &colors) {
+    for (size_t i = 0; i < style.colors.size(); ++i) {
+      const bt::Color color =
+        bt::Color::namedColor(display, 0, style.colors[i]);
+      if (color.valid())
+        colors.push_back(color);
+    }
+  }
+
+  // frees every color, including those kept from the last batch
+  void freeColors(std::vector<bt::Color> &colors) {
+    colors.clear();
+    bt::Color::clearCache();
+    bt::Color::clearCache();
+  }
+
+  long oneByOne(const bt::Display &display, const Style &style) {
+    std::vector<bt::Color> colors;
+    ::timeval start, end;
+    gettimeofday(&start, 0);
+
+    loadColors(display, style, colors);
+    for (size_t i = 0; i < colors.size(); ++i)
+      (void) colors[i].pixel(0);
+    XSync(display.XDisplay(), False);
+
+    gettimeofday(&end, 0);
+    freeColors(colors);
+    return elapsed(start, end);
+  }
+
+  // returns the time, and the requests made when drawing in requests
+  long batched(const bt::Display &display, const Style &style,
+               unsigned long &requests) {
+    ::Display * const dpy = display.XDisplay();
+    std::vector<bt::Color> colors;
+    ::timeval start, end;
+    gettimeofday(&start, 0);
+
+    bt::Color::deferAllocation();
+    loadColors(display, style, colors);
+    bt::Color::allocateDeferred();
+    bt::Color::clearCache();
+
+    const unsigned long before = NextRequest(dpy);
+    for (size_t i = 0; i < colors.size(); ++i)
+      (void) colors[i].pixel(0);
+    requests = NextRequest(dpy) - before;
+    XSync(dpy, False);
+
+    gettimeofday(&end, 0);
+    freeColors(colors);
+    return elapsed(start, end);
+  }
+
+} // namespace
+
+
+int main(void) {
+  const char * const dpy_name = getenv("DISPLAY");
+  ::Display * const probe = dpy_name ? XOpenDisplay(dpy_name) : 0;
+  if (!probe) {
+    printf("no X display, skipped\n");
+    return 77;
+  }
+  const int c_class = DefaultVisual(probe, DefaultScreen(probe))->c_class;
+  XCloseDisplay(probe);
+  if (c_class != PseudoColor && c_class != GrayScale) {
+    printf("the default visual has no writable colormap, skipped\n");
+    return 77;
+  }
+
+  const std::vector<Style> styles = readStyles(STYLEDIR);
+  if (styles.empty()) {
+    fprintf(stderr, "no styles found in %s\n", STYLEDIR);
+    return 1;
+  }
+
+  bt::Display display(dpy_name, false);
+  int failures = 0;
+  long total_single = 0l, total_batched = 0l;
+
+  printf("style           colors  one by one us  batched us  requests\n");
+  for (size_t s = 0; s < styles.size(); ++s) {
+    const Style &style = styles[s];
+    long best_single = -1l, best_batched = -1l;
+    unsigned long requests = 0ul;
+
+    for (unsigned int run = 0; run < runs; ++run) {
+      const long single = oneByOne(display, style);
+      if (best_single < 0l || single < best_single)
+        best_single = single;
+
+      unsigned long r;
+      const long batch = batched(display, style, r);
+      if (best_batched < 0l || batch < best_batched)
+        best_batched = batch;
+      requests = std::max(requests, r);
+    }
+
+    printf("%-15s %6lu %14ld %11ld %9lu\n", style.name.c_str(),
+           static_cast<unsigned long>(style.colors.size()),
+           best_single, best_batched, requests);
+    total_single += best_single;
+    total_batched += best_batched;
+
+    if (requests != 0ul) {
+      ++failures;
+      fprintf(stderr, "%s: %lu colors were freed by clearCache() before "
+              "being drawn with\n", style.name.c_str(), requests);
+    }
+  }
+
+  printf("%lu styles, one by one %ld us, batched %ld us, %d failures\n",
+         static_cast<unsigned long>(styles.size()), total_single,
+         total_batched, failures);
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; -*-
+// gradients.cc for Blackbox - an X11 Window manager
+// Copyright (c) 2001 - 2005 Sean 'Shaleh' Perry <shaleh@debian.org>
+// Copyright (c) 1997 - 2000, 2002 - 2005
+//         Bradley T Hughes <bhughes at trolltech.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+/*
+  Golden and comparison test for the gradient renderers.
+
+  Every gradient type is rendered, interlaced and not, at a fixed set
+  of sizes and colors with the scalar kernels and with each SIMD
+  kernel set the CPU supports.  The red, green and blue bytes must be
+  identical, and the scalar output must match the golden hashes
+  below.
+
+  The golden hashes are those of the original scalar gradient code,
+  before the SIMD kernels and shared gradient tables.  A change that
+  alters any gradient must update them, and say why.
+
+  The kernel tables are internal to Image.cc, so it is compiled into
+  this test directly.  The gradient members of bt::Image are private;
+  this test alone sees them as public, by defining private to public
+  around Image.hh (its own includes come first, and are unaffected).
+*/
+
+#include "Util.hh"
+
+#define private public
+#include "Image.hh"
+#undef private
+
+#include "Image.cc"
+
+#include <cstdio>
+
+
+namespace bt {
+
+  class ImageTest {
+  public:
+    enum Gradient {
+      Diagonal,
+      Elliptic,
+      Horizontal,
+      Vertical,
+      Pyramid,
+      Rectangle,
+      CrossDiagonal,
+      PipeCross,
+      SplitVertical,
+      GradientCount
+    };
+
+    static const char *name(int gradient) {
+      static const char * const names[GradientCount] = {
+        "diagonal", "elliptic", "horizontal", "vertical", "pyramid",
+        "rectangle", "crossdiagonal", "pipecross", "splitvertical"
+      };
+      return names[gradient];
+    }
+
+    // renders into data, which must hold width * height pixels
+    static void render(RGB *data, unsigned int width, unsigned int height,
+                       int gradient, const Color &from, const Color &to,
+                       bool interlaced) {
+      static RenderArena test_arena;
+      Image image(width, height);
+      image.data = data;
+      image.arena = &test_arena;
+
+      switch (gradient) {
+      case Diagonal:      image.dgradient(from, to, interlaced);  break;
+      case Elliptic:      image.egradient(from, to, interlaced);  break;
+      case Horizontal:    image.hgradient(from, to, interlaced);  break;
+      case Vertical:
+        image.partial_vgradient(from, to, interlaced, 0, height);
+        break;
+      case Pyramid:       image.pgradient(from, to, interlaced);  break;
+      case Rectangle:     image.rgradient(from, to, interlaced);  break;
+      case CrossDiagonal: image.cdgradient(from, to, interlaced); break;
+      case PipeCross:     image.pcgradient(from, to, interlaced); break;
+      case SplitVertical: image.svgradient(from, to, interlaced); break;
+      }
+      test_arena.finishRender();
+    }
+  };
+
+} // namespace bt
+
+
+namespace {
+
+  struct TestCase {
+    unsigned int width, height;
+    bt::Color from, to;
+  };
+
+  // a fixed pseudo random sequence, independent of the C library
+  unsigned int next_random = 1u;
+
+  unsigned int nextRandom(unsigned int limit) {
+    next_random = next_random * 1103515245u + 12345u;
+    return (next_random >> 16) % limit;
+  }
+
+  bt::Color randomColor(void)
+  { return bt::Color(nextRandom(256), nextRandom(256), nextRandom(256)); }
+
+  std::vector<TestCase> testCases(void) {
+    static const unsigned int sizes[][2] = {
+      { 1, 1 }, { 2, 2 }, { 1, 17 }, { 17, 1 }, { 3, 5 }, { 15, 15 },
+      { 16, 16 }, { 31, 33 }, { 64, 20 }, { 257, 19 }, { 3840, 24 },
+      { 24, 1200 }
+    };
+    std::vector<TestCase> cases;
+    next_random = 1u;
+
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+      TestCase c = { sizes[i][0], sizes[i][1], randomColor(), randomColor() };
+      cases.push_back(c);
+    }
+
+    // extreme colors
+    TestCase black_white = { 100, 30, bt::Color(0, 0, 0),
+                             bt::Color(255, 255, 255) };
+    TestCase white_black = { 30, 100, bt::Color(255, 255, 255),
+                             bt::Color(0, 0, 0) };
+    TestCase flat = { 40, 40, bt::Color(128, 64, 32),
+                      bt::Color(128, 64, 32) };
+    cases.push_back(black_white);
+    cases.push_back(white_black);
+    cases.push_back(flat);
+
+    for (unsigned int i = 0; i < 200; ++i) {
+      TestCase c = { 1 + nextRandom(300), 1 + nextRandom(60),
+                     randomColor(), randomColor() };
+      cases.push_back(c);
+    }
+    return cases;
+  }
+
+  struct KernelSet {
+    const char *name;
+    const bt::RenderKernels *kernels;
+  };
+
+  std::vector<KernelSet> supportedKernels(void) {
+    std::vector<KernelSet> sets;
+    KernelSet scalar = { "scalar", &bt::scalar_kernels };
+    sets.push_back(scalar);
+
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+      KernelSet sse2 = { "sse2", &bt::sse2_kernels };
+      sets.push_back(sse2);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      KernelSet avx2 = { "avx2", &bt::avx2_kernels };
+      sets.push_back(avx2);
+    }
+#endif // SIMD_X86
+
+    return sets;
+  }
+
+  // FNV-1a of the red, green and blue bytes of every render, per type
+  const unsigned long long golden_hashes[bt::ImageTest::GradientCount] = {
+    0x825c20bcbc9bce3dull, // diagonal
+    0x145d122d4fb203d8ull, // elliptic
+    0x53693ad4b80cc134ull, // horizontal
+    0xc2e1f3aac49c8effull, // vertical
+    0x75d3fad714d10412ull, // pyramid
+    0x10cda28e8c78a771ull, // rectangle
+    0x5bbe7afdb94158abull, // crossdiagonal
+    0xd45b2dd50ebaa224ull, // pipecross
+    0x4eca10a9dc4e6588ull  // splitvertical
+  };
+
+  void hash(unsigned long long &h, const std::vector<bt::RGB> &pixels) {
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      const unsigned char bytes[3] = {
+        static_cast<unsigned char>(pixels[i].red),
+        static_cast<unsigned char>(pixels[i].green),
+        static_cast<unsigned char>(pixels[i].blue)
+      };
+      for (int b = 0; b < 3; ++b) {
+        h ^= bytes[b];
+        h *= 1099511628211ull;
+      }
+    }
+  }
+
+  // returns the index of the first pixel that differs, or -1
+  long compare(const std::vector<bt::RGB> &a, const std::vector<bt::RGB> &b) {
+    for (size_t i = 0; i < a.size(); ++i) {
+      if (a[i].red != b[i].red || a[i].green != b[i].green
+          || a[i].blue != b[i].blue)
+        return static_cast<long>(i);
+    }
+    return -1;
+  }
+
+} // namespace
+
+
+int main(void) {
+  const std::vector<TestCase> cases = testCases();
+  const std::vector<KernelSet> sets = supportedKernels();
+  int failures = 0;
+  unsigned long long hashes[bt::ImageTest::GradientCount];
+  for (int g = 0; g < bt::ImageTest::GradientCount; ++g)
+    hashes[g] = 14695981039346656037ull;
+
+  for (size_t k = 1; k < sets.size(); ++k)
+    printf("comparing %s kernels with scalar kernels\n", sets[k].name);
+  if (sets.size() == 1)
+    printf("no SIMD kernels available, checking scalar kernels only\n");
+
+  for (size_t n = 0; n < cases.size(); ++n) {
+    const TestCase &c = cases[n];
+    const size_t pixels = c.width * c.height;
+
+    for (int g = 0; g < bt::ImageTest::GradientCount; ++g) {
+      for (int interlaced = 0; interlaced < 2; ++interlaced) {
+        std::vector<bt::RGB> reference(pixels);
+        bt::render_kernels = &bt::scalar_kernels;
+        bt::ImageTest::render(&reference[0], c.width, c.height, g,
+                              c.from, c.to, interlaced);
+        hash(hashes[g], reference);
+
+        for (size_t k = 1; k < sets.size(); ++k) {
+          std::vector<bt::RGB> output(pixels);
+          bt::render_kernels = sets[k].kernels;
+          bt::ImageTest::render(&output[0], c.width, c.height, g,
+                                c.from, c.to, interlaced);
+
+          const long i = compare(reference, output);
+          if (i < 0)
+            continue;
+          ++failures;
+          fprintf(stderr,
+                  "%s %s%s %ux%u: pixel (%lu, %lu) is %u,%u,%u, "
+                  "scalar gives %u,%u,%u\n",
+                  sets[k].name, interlaced ? "interlaced " : "",
+                  bt::ImageTest::name(g), c.width, c.height,
+                  i % c.width, i / c.width,
+                  output[i].red, output[i].green, output[i].blue,
+                  reference[i].red, reference[i].green, reference[i].blue);
+        }
+      }
+    }
+  }
+
+  for (int g = 0; g < bt::ImageTest::GradientCount; ++g) {
+    if (hashes[g] == golden_hashes[g])
+      continue;
+    ++failures;
+    fprintf(stderr, "%s: output hash is 0x%016llx, expected 0x%016llx\n",
+            bt::ImageTest::name(g), hashes[g], golden_hashes[g]);
+  }
+
+  printf("%lu cases, %d mismatches\n",
+         static_cast<unsigned long>(cases.size()), failures);
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; -*-
+// unicode.cc for Blackbox - an X11 Window manager
+// Copyright (c) 2001 - 2005 Sean 'Shaleh' Perry <shaleh@debian.org>
+// Copyright (c) 1997 - 2000, 2002 - 2005
+//         Bradley T Hughes <bhughes at trolltech.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+/*
+  Checks the native UTF-8 codec and the iconv conversions used for
+  other locale codesets.  ISO-2022-JP is used as the stateful
+  codeset: each conversion must end in the initial shift state, and
+  a replacement character must not be written while shifted.
+
+  The codecs are internal to Unicode.cc, so it is compiled into this
+  test directly.
+*/
+
+#include "Unicode.cc"
+
+#include <cstdio>
+
+
+namespace {
+
+  unsigned int failures = 0;
+
+  std::string hex(const std::string &bytes) {
+    std::string ret;
+    for (std::string::size_type i = 0; i < bytes.size(); ++i) {
+      char buf[4];
+      sprintf(buf, "%s%02x", i ? " " : "",
+              static_cast<unsigned char>(bytes[i]));
+      ret += buf;
+    }
+    return ret;
+  }
+
+  void check(const char *what, const std::string &result,
+             const std::string &expected) {
+    if (result == expected)
+      return;
+    ++failures;
+    fprintf(stderr, "%s: got '%s', expected '%s'\n",
+            what, hex(result).c_str(), hex(expected).c_str());
+  }
+
+  void check(const char *what, const bt::ustring &result,
+             const bt::ustring &expected) {
+    if (result == expected)
+      return;
+    ++failures;
+    fprintf(stderr, "%s: got %u characters, expected %u\n",
+            what, static_cast<unsigned int>(result.size()),
+            static_cast<unsigned int>(expected.size()));
+  }
+
+  bt::ustring utf32(const bt::Uchar *chars) {
+    bt::ustring ret;
+    for (; *chars; ++chars)
+      ret += *chars;
+    return ret;
+  }
+
+  void testUtf8(void) {
+    const bt::Uchar text[] = { 'a', 0xe9, 0x65e5, 0x1f600, 0 };
+    const std::string utf8 = "a\xc3\xa9\xe6\x97\xa5\xf0\x9f\x98\x80";
+    check("encode", bt::encodeUtf8(utf32(text)), utf8);
+    check("decode", bt::decodeUtf8(utf8), utf32(text));
+
+    // long enough for the SIMD runs, with a character after them
+    const std::string ascii = "0123456789abcdefghijklmnopqrstuv\xc3\xa9";
+    check("ascii", bt::encodeUtf8(bt::decodeUtf8(ascii)), ascii);
+
+    // a stray continuation byte, an overlong form and a truncated tail
+    const bt::Uchar replaced[] =
+      { 0xfffd, 'x', 0xfffd, 0xfffd, 'y', 0xfffd, 0 };
+    check("malformed", bt::decodeUtf8("\x80x\xc0\xafy\xe6\x97"),
+          utf32(replaced));
+  }
+
+  bool testShiftState(void) {
+    const bt::Uchar one = 1;
+    const char * const native =
+      (*reinterpret_cast<const unsigned char *>(&one) == 1)
+      ? "UTF-32LE"
+      : "UTF-32BE";
+    bt::IconvSlot encode = { "ISO-2022-JP", native, bt::invalid };
+    bt::IconvSlot decode = { native, "ISO-2022-JP", bt::invalid };
+
+    iconv_t cd = bt::takeIconv(encode);
+    if (cd == bt::invalid)
+      return false;
+    bt::putIconv(encode, cd);
+
+    const bt::Uchar nihon[] = { 0x65e5, 0x672c, 0 };
+    const std::string nihon_jis = "\x1b$BF|K\\\x1b(B";
+    std::string out;
+    bt::convert(encode, utf32(nihon), out, '?');
+    check("shift state", out, nihon_jis);
+
+    // the cached descriptor starts over in the initial state
+    bt::convert(encode, utf32(nihon), out, '?');
+    check("cached descriptor", out, nihon_jis);
+
+    // the conversion fills the buffer, the flush has to grow it
+    const bt::Uchar mixed[] = { 'a', 0x65e5, 0 };
+    bt::convert(encode, utf32(mixed), out, '?');
+    check("flush grows", out, "a\x1b$BF|\x1b(B");
+
+    // U+00E9 is not in JIS X 0208, its replacement is plain ASCII
+    const bt::Uchar accented[] = { 0x65e5, 0xe9, 0x672c, 0 };
+    bt::convert(encode, utf32(accented), out, '?');
+    check("replacement", out, "\x1b$BF|\x1b(B?\x1b$BK\\\x1b(B");
+
+    bt::ustring back;
+    bt::convert(decode, nihon_jis, back, bt::replacement_character);
+    check("decode", back, utf32(nihon));
+
+    return true;
+  }
+
+} // namespace
+
+
+int main(int, char **) {
+  testUtf8();
+
+  if (!testShiftState())
+    fprintf(stderr, "ISO-2022-JP not supported by iconv, skipped\n");
+
+  if (failures != 0) {
+    fprintf(stderr, "%u failures\n", failures);
+    return 1;
+  }
+  return 0;
+}
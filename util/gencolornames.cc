@@ -0,0 +1,178 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; -*-
+// gencolornames.cc for Blackbox - an X11 Window manager
+// Copyright (c) 2001 - 2005 Sean 'Shaleh' Perry <shaleh@debian.org>
+// Copyright (c) 1997 - 2000, 2002 - 2005
+//         Bradley T Hughes <bhughes at trolltech.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+/*
+  Generates the color name tables in lib/ColorNames.cc from rgb.txt:
+
+    make -C util gencolornames
+    util/gencolornames /usr/share/X11/rgb.txt
+
+  prints the displacements and color_names tables, which replace the
+  ones in lib/ColorNames.cc.  Names are lower cased; the first
+  spelling of a name decides its place and the last its value, like
+  the X server.  ColorNames.cc is compiled into this program, so the
+  tables are built with the same colorNameHash() that reads them.
+*/
+
+#include "ColorNames.cc"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+
+namespace {
+
+  struct Color {
+    int red, green, blue;
+  };
+
+  std::string trim(const std::string &str) {
+    const std::string::size_type first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+      return std::string();
+    const std::string::size_type last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+  }
+
+  // orders buckets by size, largest first, then by number
+  struct LargerBucket {
+    const std::vector<std::vector<std::string> > &buckets;
+
+    LargerBucket(const std::vector<std::vector<std::string> > &b)
+      : buckets(b)
+    { }
+    bool operator()(unsigned int a, unsigned int b) const {
+      if (buckets[a].size() != buckets[b].size())
+        return buckets[a].size() > buckets[b].size();
+      return a < b;
+    }
+  };
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+  const char * const path = (argc > 1) ? argv[1] : "/usr/share/X11/rgb.txt";
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], path);
+    return 1;
+  }
+
+  std::vector<std::string> names;
+  std::map<std::string, Color> colors;
+  char line[1024];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '!')
+      continue;
+    Color color;
+    int n = 0;
+    if (sscanf(line, "%d %d %d %n", &color.red, &color.green, &color.blue,
+               &n) != 3 || n == 0)
+      continue;
+
+    std::string name = trim(line + n);
+    if (name.empty())
+      continue;
+    for (std::string::size_type i = 0; i < name.length(); ++i)
+      name[i] = tolower(static_cast<unsigned char>(name[i]));
+
+    if (colors.find(name) == colors.end())
+      names.push_back(name);
+    colors[name] = color;
+  }
+  fclose(file);
+
+  const unsigned int bucket_count = 256u;
+  const unsigned int slot_count = names.size();
+
+  std::vector<std::vector<std::string> > buckets(bucket_count);
+  for (unsigned int i = 0; i < names.size(); ++i)
+    buckets[bt::colorNameHash(names[i], 0) % bucket_count].push_back(names[i]);
+
+  std::vector<unsigned int> order(bucket_count);
+  for (unsigned int i = 0; i < bucket_count; ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), LargerBucket(buckets));
+
+  // find a seed for each bucket that puts its names in free slots
+  std::vector<unsigned int> displacements(bucket_count, 0u);
+  std::vector<std::string> slots(slot_count);
+  std::vector<bool> used(slot_count, false);
+  for (unsigned int o = 0; o < bucket_count; ++o) {
+    const std::vector<std::string> &bucket = buckets[order[o]];
+    if (bucket.empty())
+      continue;
+
+    unsigned int seed = 1u;
+    for (; seed < 65536u; ++seed) {
+      std::vector<unsigned int> positions;
+      bool ok = true;
+      for (unsigned int i = 0; ok && i < bucket.size(); ++i) {
+        const unsigned int p = bt::colorNameHash(bucket[i], seed) % slot_count;
+        ok = !used[p]
+             && std::find(positions.begin(), positions.end(), p)
+                == positions.end();
+        positions.push_back(p);
+      }
+      if (!ok)
+        continue;
+
+      for (unsigned int i = 0; i < bucket.size(); ++i) {
+        slots[positions[i]] = bucket[i];
+        used[positions[i]] = true;
+      }
+      displacements[order[o]] = seed;
+      break;
+    }
+    if (seed == 65536u) {
+      fprintf(stderr, "%s: no seed found for bucket %u\n",
+              argv[0], order[o]);
+      return 1;
+    }
+  }
+
+  printf("  static const unsigned short displacements[%u] = {\n",
+         bucket_count);
+  for (unsigned int i = 0; i < bucket_count; i += 10) {
+    printf("   ");
+    for (unsigned int j = i; j < i + 10 && j < bucket_count; ++j)
+      printf(" %5u,", displacements[j]);
+    printf("\n");
+  }
+  printf("  };\n\n");
+
+  printf("  static const ColorName color_names[%u] = {\n", slot_count);
+  for (unsigned int i = 0; i < slot_count; ++i) {
+    const Color &color = colors[slots[i]];
+    printf("    { \"%s\", %d, %d, %d },\n", slots[i].c_str(),
+           color.red, color.green, color.blue);
+  }
+  printf("  };\n");
+
+  return 0;
+}